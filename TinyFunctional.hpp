@@ -1,8 +1,20 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <functional>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
 #include <optional>
+#include <thread>
+#include <tuple>
 #include <type_traits>
+#include <utility>
+#include <vector>
+#include "TinyFunctionalTypes.hpp"
 
 #ifdef PERFECT_CAPTURE_BREAKS_GCC
 #   define FORWARD(VARIABLE) std::forward<decltype(VARIABLE)>(VARIABLE)
@@ -36,26 +48,224 @@ struct largest_type {
 
 }
 
-/* Basic tag type
+/* Basic tag types.
+ * The lower-case names are kept as aliases of the types thrown by the
+ * containers in TinyFunctionalTypes.hpp.
  */
-struct error {};
+using error = Error;
 
-struct bad_access : error {};
+using bad_access = BadAccess;
 
-/* nullvalue_t is a tag to have compile-time invalid types.
- * nullvalue_t defines an explicit constructor to ensure that automatic
- * template deduction does not interpret {} as a nullvalue_t when used
- * for construction.
+namespace detail {
+
+/* Lazy collections derive from lazy_collection_base and implement traverse(s).
+ * traverse(s) pushes every element into the sink s, and stops as soon as the
+ * sink returns false. traverse returns false if the sink stopped the traversal.
  */
-struct nullvalue_t {
-    explicit constexpr nullvalue_t(int) {};
-};
-/* we define a typed invalid value called nullvalue, this serves the same
- * purpose as nullptr.
+struct lazy_collection_base {};
+
+template <class T>
+constexpr bool is_lazy_collection_v =
+    std::is_base_of_v<lazy_collection_base, std::remove_cvref_t<T>>;
+
+/* Lazy collections are small and are stored by value when chained,
+ * concrete collections are only referenced.
+ */
+template <class A>
+using lazy_storage_t = std::conditional_t<is_lazy_collection_v<A>, A, A const&>;
+
+template< class, class = std::void_t<> >
+struct is_random_access_collection : std::false_type { };
+
+template< class C >
+struct is_random_access_collection<C, std::void_t<decltype(std::declval<C const&>().begin())>>
+    : std::is_base_of<std::random_access_iterator_tag,
+                      typename std::iterator_traits<
+                          decltype(std::declval<C const&>().begin())>::iterator_category> { };
+
+template <class C>
+constexpr bool is_random_access_collection_v = is_random_access_collection<C>::value;
+
+template< class, class = std::void_t<> >
+struct has_reserve : std::false_type { };
+
+template< class C >
+struct has_reserve<C, std::void_t<decltype(std::declval<C&>().reserve(size_t{}))>>
+    : std::true_type { };
+
+template <class C>
+constexpr bool has_reserve_v = has_reserve<C>::value;
+
+template< class, class = std::void_t<> >
+struct has_push_back : std::false_type { };
+
+template< class C >
+struct has_push_back<C, std::void_t<decltype(std::declval<C&>().push_back(
+                                        std::declval<typename C::value_type>()))>>
+    : std::true_type { };
+
+template <class C>
+constexpr bool has_push_back_v = has_push_back<C>::value;
+
+template <class C>
+struct is_std_array : std::false_type { };
+
+template <class T, size_t N>
+struct is_std_array<std::array<T, N>> : std::true_type { };
+
+template <class C>
+constexpr bool is_std_array_v = is_std_array<C>::value;
+
+/* The size hint of a collection is its exact size when it is known without
+ * traversing the collection.
+ */
+template <class C, std::enable_if_t<is_lazy_collection_v<C>, int> = 0>
+constexpr auto size_hint(C const& c) -> decltype(size_t(c.size_hint())) {
+    return c.size_hint();
+}
+
+template <class C, std::enable_if_t<!is_lazy_collection_v<C>, int> = 0>
+constexpr auto size_hint(C const& c) -> decltype(size_t(c.size())) {
+    return c.size();
+}
+
+template< class, class = std::void_t<> >
+struct has_size_hint : std::false_type { };
+
+template< class C >
+struct has_size_hint<C, std::void_t<decltype(size_hint(std::declval<C const&>()))>>
+    : std::true_type { };
+
+template <class C>
+constexpr bool has_size_hint_v = has_size_hint<C>::value;
+
+/* Indexed collections are random access collections, or lazy collections
+ * with an element accessor operator[] and a known size.
+ */
+template< class, class = std::void_t<> >
+struct is_indexed_lazy_collection : std::false_type { };
+
+template< class C >
+struct is_indexed_lazy_collection<C, std::void_t<decltype(std::declval<C const&>()[size_t{}]),
+                                                 decltype(std::declval<C const&>().size_hint())>>
+    : std::bool_constant<is_lazy_collection_v<C>> { };
+
+template <class C>
+constexpr bool is_indexed_v =
+    is_random_access_collection_v<C> || is_indexed_lazy_collection<C>::value;
+
+template <class C>
+constexpr decltype(auto) element(C const& c, size_t i) {
+    if constexpr (is_lazy_collection_v<C>)
+        return c[i];
+    else
+        return c.begin()[i];
+}
+
+template< class, class = std::void_t<> >
+struct has_resize : std::false_type { };
+
+template< class C >
+struct has_resize<C, std::void_t<decltype(std::declval<C&>().resize(size_t{}))>>
+    : std::true_type { };
+
+template <class C>
+constexpr bool has_resize_v = has_resize<C>::value;
+
+template <typename It, typename S>
+constexpr bool traverse_iterator(It begin, It end, S&& s) {
+    for (auto it = begin; it != end; it++)
+        if (!s(*it))
+            return false;
+    return true;
+}
+
+template <typename C, typename S>
+constexpr bool traverse(C const& c, S&& s) {
+    if constexpr (is_lazy_collection_v<C>)
+        return c.traverse(std::forward<S>(s));
+    else
+        return traverse_iterator(c.begin(), c.end(), std::forward<S>(s));
+}
+
+}
+
+/* [A] -> [B]
+ *
+ * 'LazyCollection' is the common base of all lazy collections and handles the
+ * materialization into a typed collection value.
+ * The derived collection D only needs to implement traverse().
  */
-constexpr nullvalue_t nullvalue{0};
+template <typename D>
+class LazyCollection : public detail::lazy_collection_base {
+public:
+    /* Materialize into B using the cheapest insertion B supports.
+     * std::array is filled up to its compile-time size, arithmetic vectors of
+     * indexed collections are assigned in a single counted loop, sequences are
+     * reserved up front when the size is known and appended to, and
+     * associative containers are inserted into with a hint at their end.
+     */
+    template <typename B>
+    constexpr B get() const {
+        if constexpr (detail::is_std_array_v<B>) {
+            B out{};
+            size_t i = 0;
+            if (out.size() != 0)
+                self().traverse([&](auto&& e) {
+                    out[i++] = std::forward<decltype(e)>(e);
+                    return i < out.size();
+                });
+            return out;
+        }
+        else if constexpr (detail::is_indexed_lazy_collection<D>::value
+                           && detail::has_resize_v<B>
+                           && detail::is_random_access_collection_v<B>
+                           && std::is_arithmetic_v<typename B::value_type>) {
+            B out;
+            const size_t size = self().size_hint();
+            out.resize(size);
+            for (size_t i = 0; i < size; i++)
+                out[i] = self()[i];
+            return out;
+        }
+        else {
+            B out;
+            if constexpr (detail::has_reserve_v<B> && detail::has_size_hint_v<D>)
+                out.reserve(self().size_hint());
+            fill(out);
+            return out;
+        }
+    }
+
+    /* Materialize into B with storage reserved up front for 'reserve'
+     * elements, given as an estimate of the final size.
+     */
+    template <typename B>
+    constexpr B get(size_t reserve) const {
+        B out;
+        if constexpr (detail::has_reserve_v<B>)
+            out.reserve(reserve);
+        fill(out);
+        return out;
+    }
 
+    template <typename B>
+    operator B() const { return get<B>(); }
 
+private:
+    constexpr D const& self(void) const { return static_cast<D const&>(*this); }
+
+    template <typename B>
+    constexpr void fill(B& out) const {
+        self().traverse([&](auto&& e) {
+            if constexpr (detail::has_push_back_v<B>)
+                out.push_back(std::forward<decltype(e)>(e));
+            else
+                out.emplace_hint(out.end(), std::forward<decltype(e)>(e));
+            return true;
+        });
+    }
+};
 
 /* F([A]) -> [B]
  *
@@ -69,76 +279,858 @@ constexpr nullvalue_t nullvalue{0};
  * handled when assigned to a typed collection value.
  */
 template<typename A, typename F>
-class LazyTransformation {
+class LazyTransformation : public LazyCollection<LazyTransformation<A, F>> {
 public:
     using collection_type = A;
 
-    LazyTransformation(A const& in, F&& f) : in(in), f(std::move(f)) { }
+    template <typename G>
+    LazyTransformation(A const& in, G&& f) : in(in), f(std::forward<G>(f)) { }
 
-    template <typename B>
-    constexpr B get() const {
-        B out;
-        for_each([&](auto e) {out.push_back(f(e)); }, in);
-        return out;
+    template <typename S>
+    constexpr bool traverse(S&& s) const {
+        return detail::traverse(in, [&](auto&& e) {
+            return s(std::invoke(f, std::forward<decltype(e)>(e)));
+        });
     }
 
-    template <typename B>
-    operator B() const { return get<B>(); }
-
     template<typename B> 
-    constexpr B operator*(void) const { return get(); }
+    constexpr B operator*(void) const { return this->template get<B>(); }
+
+    constexpr size_t size_hint(void) const requires detail::has_size_hint_v<A> {
+        return detail::size_hint(in);
+    }
+
+    constexpr auto operator[](size_t i) const requires detail::is_indexed_v<A> {
+        return std::invoke(f, detail::element(in, i));
+    }
 
 private:
-    A const& in;
+    detail::lazy_storage_t<A> in;
     F f;
 };
 
-/* 'strip' removing the monadic wrapper from its value.
- */
-template <typename T>
-[[nodiscard]]
-constexpr T inline strip(std::optional<T> opt) {
-    if (opt) return *opt;
-    return {};
+/* F([A]) -> [B]
+ *
+ * 'LazyMemoTransformation' models the transition from collection [A] to
+ * collection [B] given the transformer F, like LazyTransformation, but
+ * remembers each transformed element once it has been evaluated;
+ *
+ * Each F(a_i) is evaluated on first traversal and stored in a side array,
+ * with a bitmap tracking which elements are evaluated. Later traversals and
+ * materializations reuse the stored results. Copies of a LazyMemoTransformation
+ * share the same results.
+ * Elements may be evaluated from several threads at once, as by the parallel
+ * algorithms: a thread claims an element before evaluating it, and threads
+ * reading an element claimed by another wait until it is stored. F is
+ * evaluated at most once per element, unless it throws.
+ * The memoization is indexed by position and requires a random access
+ * collection [A]. If [A] is modified, reset() discards the stored results;
+ * reset() must not run concurrently with traversals.
+ */
+template<typename A, typename F>
+class LazyMemoTransformation : public LazyCollection<LazyMemoTransformation<A, F>> {
+public:
+    using collection_type = A;
+    using value_type = std::remove_cvref_t<
+        std::invoke_result_t<F const&, decltype(*std::declval<A const&>().begin())>>;
+
+    static_assert(detail::is_random_access_collection_v<A>,
+                  "f::LazyMemoTransformation requires a random access collection");
+
+    template <typename G>
+    LazyMemoTransformation(A const& in, G&& f)
+        : in(in), f(std::forward<G>(f)), cache(std::make_shared<Cache>(in.size())) { }
+
+    template <typename S>
+    constexpr bool traverse(S&& s) const {
+        const size_t size = std::min(cache->size, static_cast<size_t>(in.size()));
+        for (size_t i = 0; i < size; i++)
+            if (!s(evaluate(i)))
+                return false;
+        return true;
+    }
+
+    constexpr size_t size_hint(void) const {
+        return std::min(cache->size, static_cast<size_t>(in.size()));
+    }
+
+    constexpr value_type const& operator[](size_t i) const {
+        return evaluate(i);
+    }
+
+    constexpr bool has_evaluated(size_t i) const {
+        return cache->engaged(i);
+    }
+
+    /* Discard all stored results, the collection is reevaluated on next
+     * traversal.
+     */
+    void reset(void) {
+        cache = std::make_shared<Cache>(in.size());
+    }
+
+private:
+    struct Slot {
+        union { nullvalue_t null; value_type value; };
+        Slot(void) noexcept {};
+        ~Slot(void) {};
+    };
+
+    struct Cache {
+        size_t size;
+        std::unique_ptr<Slot[]> slots;
+        std::unique_ptr<std::atomic<uint64_t>[]> ready;     ///< stored elements
+        std::unique_ptr<std::atomic<uint64_t>[]> claimed;   ///< elements being or been evaluated
+
+        explicit Cache(size_t size)
+            : size(size),
+              slots(new Slot[size]),
+              ready(new std::atomic<uint64_t>[(size + 63) / 64]()),
+              claimed(new std::atomic<uint64_t>[(size + 63) / 64]()) {}
+
+        ~Cache(void) {
+            if constexpr (!std::is_trivially_destructible_v<value_type>)
+                for (size_t i = 0; i < size; i++)
+                    if (engaged(i))
+                        slots[i].value.~value_type();
+        }
+
+        bool engaged(size_t i) const {
+            return ready[i / 64].load(std::memory_order_acquire) & (uint64_t{1} << (i % 64));
+        }
+    };
+
+    value_type const& evaluate(size_t i) const {
+        Slot& slot = cache->slots[i];
+        const uint64_t bit = uint64_t{1} << (i % 64);
+        std::atomic<uint64_t>& ready = cache->ready[i / 64];
+        std::atomic<uint64_t>& claimed = cache->claimed[i / 64];
+        while (!(ready.load(std::memory_order_acquire) & bit)) {
+            if (claimed.fetch_or(bit, std::memory_order_acquire) & bit) {
+                std::this_thread::yield();
+                continue;
+            }
+            try {
+                new (static_cast<void*>(&slot.value)) value_type(std::invoke(f, in.begin()[i]));
+            }
+            catch (...) {
+                claimed.fetch_and(~bit, std::memory_order_relaxed);
+                throw;
+            }
+            ready.fetch_or(bit, std::memory_order_release);
+            break;
+        }
+        return slot.value;
+    }
+
+    detail::lazy_storage_t<A> in;
+    F f;
+    std::shared_ptr<Cache> cache;
+};
+
+/* P([A]) -> [A]
+ *
+ * 'LazyFilter' models the collection of elements in [A] that satisfy the
+ * predicate P.
+ */
+template<typename A, typename P>
+class LazyFilter : public LazyCollection<LazyFilter<A, P>> {
+public:
+    using collection_type = A;
+
+    template <typename G>
+    LazyFilter(A const& in, G&& p) : in(in), p(std::forward<G>(p)) { }
+
+    template <typename S>
+    constexpr bool traverse(S&& s) const {
+        return detail::traverse(in, [&](auto&& e) {
+            return !std::invoke(p, e) || s(std::forward<decltype(e)>(e));
+        });
+    }
+
+private:
+    detail::lazy_storage_t<A> in;
+    P p;
+};
+
+/* N([A]) -> [A]
+ *
+ * 'LazyTake' models the collection of the first N elements in [A].
+ * The traversal of [A] is stopped once N elements have been taken.
+ */
+template<typename A>
+class LazyTake : public LazyCollection<LazyTake<A>> {
+public:
+    using collection_type = A;
+
+    LazyTake(A const& in, size_t n) : in(in), n(n) { }
+
+    template <typename S>
+    constexpr bool traverse(S&& s) const {
+        if (n == 0)
+            return true;
+        size_t left = n;
+        bool stopped = false;
+        detail::traverse(in, [&](auto&& e) {
+            if (!s(std::forward<decltype(e)>(e))) {
+                stopped = true;
+                return false;
+            }
+            return --left != 0;
+        });
+        return !stopped;
+    }
+
+    constexpr size_t size_hint(void) const requires detail::has_size_hint_v<A> {
+        return std::min(n, detail::size_hint(in));
+    }
+
+    constexpr decltype(auto) operator[](size_t i) const requires detail::is_indexed_v<A> {
+        return detail::element(in, i);
+    }
+
+private:
+    detail::lazy_storage_t<A> in;
+    size_t n;
+};
+
+/* N([A]) -> [A]
+ *
+ * 'LazyDrop' models the collection [A] without its first N elements.
+ * Random access collections skip the first N elements without visiting them.
+ */
+template<typename A>
+class LazyDrop : public LazyCollection<LazyDrop<A>> {
+public:
+    using collection_type = A;
+
+    LazyDrop(A const& in, size_t n) : in(in), n(n) { }
+
+    template <typename S>
+    constexpr bool traverse(S&& s) const {
+        if constexpr (detail::is_random_access_collection_v<A>) {
+            const size_t skip = std::min<size_t>(n, in.end() - in.begin());
+            return detail::traverse_iterator(in.begin() + skip, in.end(), s);
+        }
+        else {
+            size_t left = n;
+            return detail::traverse(in, [&](auto&& e) {
+                if (left != 0) {
+                    --left;
+                    return true;
+                }
+                return s(std::forward<decltype(e)>(e));
+            });
+        }
+    }
+
+    constexpr size_t size_hint(void) const requires detail::has_size_hint_v<A> {
+        const size_t size = detail::size_hint(in);
+        return size - std::min(n, size);
+    }
+
+    constexpr decltype(auto) operator[](size_t i) const requires detail::is_indexed_v<A> {
+        return detail::element(in, i + n);
+    }
+
+private:
+    detail::lazy_storage_t<A> in;
+    size_t n;
+};
+
+/* P([A]) -> [A]
+ *
+ * 'LazyTakeWhile' models the leading elements of [A] that satisfy the
+ * predicate P.
+ * The traversal of [A] is stopped at the first element not satisfying P.
+ */
+template<typename A, typename P>
+class LazyTakeWhile : public LazyCollection<LazyTakeWhile<A, P>> {
+public:
+    using collection_type = A;
+
+    template <typename G>
+    LazyTakeWhile(A const& in, G&& p) : in(in), p(std::forward<G>(p)) { }
+
+    template <typename S>
+    constexpr bool traverse(S&& s) const {
+        bool stopped = false;
+        detail::traverse(in, [&](auto&& e) {
+            if (!std::invoke(p, e))
+                return false;
+            if (!s(std::forward<decltype(e)>(e))) {
+                stopped = true;
+                return false;
+            }
+            return true;
+        });
+        return !stopped;
+    }
+
+private:
+    detail::lazy_storage_t<A> in;
+    P p;
+};
+
+/* N([A]) -> [A]
+ *
+ * 'LazyStride' models every N'th element of [A], starting with the first.
+ * Random access collections only visit the elements that are strided to.
+ * A stride of 0 is treated as a stride of 1.
+ */
+template<typename A>
+class LazyStride : public LazyCollection<LazyStride<A>> {
+public:
+    using collection_type = A;
+
+    LazyStride(A const& in, size_t n) : in(in), n(n == 0 ? 1 : n) { }
+
+    template <typename S>
+    constexpr bool traverse(S&& s) const {
+        if constexpr (detail::is_random_access_collection_v<A>) {
+            const size_t size = in.end() - in.begin();
+            for (size_t i = 0; i < size; i += n)
+                if (!s(in.begin()[i]))
+                    return false;
+            return true;
+        }
+        else {
+            size_t skip = 0;
+            return detail::traverse(in, [&](auto&& e) {
+                if (skip != 0) {
+                    --skip;
+                    return true;
+                }
+                skip = n - 1;
+                return s(std::forward<decltype(e)>(e));
+            });
+        }
+    }
+
+    constexpr size_t size_hint(void) const requires detail::has_size_hint_v<A> {
+        return (detail::size_hint(in) + n - 1) / n;
+    }
+
+    constexpr decltype(auto) operator[](size_t i) const requires detail::is_indexed_v<A> {
+        return detail::element(in, i * n);
+    }
+
+private:
+    detail::lazy_storage_t<A> in;
+    size_t n;
+};
+
+/* F([A], [B], ...) -> [C]
+ *
+ * 'LazyZipTransformation' models the transition from the collections
+ * [A], [B], ... to collection [C] given the transformer F taking one element
+ * of each collection;
+ *
+ * The collections are traversed in lock-step and the transformation ends with
+ * the shortest collection. Random access collections are traversed by index
+ * in a single counted loop, allowing the transform to be vectorized.
+ * Lazy collections can be zipped when they are indexed.
+ */
+template<typename F, typename... Cs>
+class LazyZipTransformation : public LazyCollection<LazyZipTransformation<F, Cs...>> {
+public:
+    static_assert(sizeof...(Cs) > 0,
+                  "Creating f::LazyZipTransformation of no collections is ill-formed");
+    static_assert((... && (!detail::is_lazy_collection_v<Cs> || detail::is_indexed_v<Cs>)),
+                  "f::LazyZipTransformation requires iterable or indexed collections");
+
+    template <typename G>
+    LazyZipTransformation(G&& f, Cs const&... in) : f(std::forward<G>(f)), in(in...) { }
+
+    template <typename S>
+    constexpr bool traverse(S&& s) const {
+        return std::apply([&](auto const&... c) {
+            if constexpr ((... && detail::is_indexed_v<Cs>)) {
+                const size_t size = std::min({size_t(detail::size_hint(c))...});
+                for (size_t i = 0; i < size; i++)
+                    if (!s(std::invoke(f, detail::element(c, i)...)))
+                        return false;
+                return true;
+            }
+            else {
+                static_assert((... && !detail::is_lazy_collection_v<Cs>),
+                              "f::LazyZipTransformation of lazy collections requires "
+                              "every collection to be indexed");
+                auto its = std::make_tuple(c.begin()...);
+                const auto ends = std::make_tuple(c.end()...);
+                const auto any_end = [&]<size_t... I>(std::index_sequence<I...>) {
+                    return (... || (std::get<I>(its) == std::get<I>(ends)));
+                };
+                while (!any_end(std::index_sequence_for<Cs...>{})) {
+                    const bool more = std::apply([&](auto&... it) {
+                        return s(std::invoke(f, *it...));
+                    }, its);
+                    if (!more)
+                        return false;
+                    std::apply([](auto&... it) { (..., ++it); }, its);
+                }
+                return true;
+            }
+        }, in);
+    }
+
+    constexpr size_t size_hint(void) const requires (... && detail::has_size_hint_v<Cs>) {
+        return std::apply([](auto const&... c) {
+            return std::min({size_t(detail::size_hint(c))...});
+        }, in);
+    }
+
+    constexpr auto operator[](size_t i) const requires (... && detail::is_indexed_v<Cs>) {
+        return std::apply([&](auto const&... c) {
+            return std::invoke(f, detail::element(c, i)...);
+        }, in);
+    }
+
+private:
+    F f;
+    std::tuple<detail::lazy_storage_t<Cs>...> in;
+};
+
+/* F([A]) -> [B]
+ *
+ * 'LazyFlatTransformation' models the transition from collection [A] to
+ * collection [B] given the transformer F producing a collection [B] for each
+ * element of [A];
+ *
+ * The produced collections are concatenated lazily, elements of collections
+ * returned by value are moved into the result.
+ * size() is a sizing pass evaluating F on all elements, it can be used to
+ * materialize into a single pre-sized buffer using get<B>(size).
+ */
+template<typename A, typename F>
+class LazyFlatTransformation : public LazyCollection<LazyFlatTransformation<A, F>> {
+public:
+    using collection_type = A;
+
+    template <typename G>
+    LazyFlatTransformation(A const& in, G&& f) : in(in), f(std::forward<G>(f)) { }
+
+    template <typename S>
+    constexpr bool traverse(S&& s) const {
+        return detail::traverse(in, [&](auto&& e) {
+            using R = decltype(std::invoke(f, std::forward<decltype(e)>(e)));
+            decltype(auto) r = std::invoke(f, std::forward<decltype(e)>(e));
+            if constexpr (detail::is_lazy_collection_v<R> || std::is_reference_v<R>)
+                return detail::traverse(r, s);
+            else
+                return detail::traverse_iterator(std::make_move_iterator(r.begin()),
+                                                 std::make_move_iterator(r.end()), s);
+        });
+    }
+
+    constexpr size_t size(void) const {
+        size_t n = 0;
+        detail::traverse(in, [&](auto&& e) {
+            decltype(auto) r = std::invoke(f, std::forward<decltype(e)>(e));
+            if constexpr (detail::is_lazy_collection_v<decltype(r)>)
+                r.traverse([&](auto&&) { n++; return true; });
+            else
+                n += std::distance(r.begin(), r.end());
+            return true;
+        });
+        return n;
+    }
+
+private:
+    detail::lazy_storage_t<A> in;
+    F f;
+};
+
+/* 'strip' removing the monadic wrapper from its value.
+ */
+template <typename T>
+[[nodiscard]]
+constexpr T inline strip(std::optional<T> opt) {
+    if (opt) return *opt;
+    return {};
+}
+
+template <typename T>
+[[nodiscard]]
+constexpr inline T strip(Lazy<T> opt) {
+    if (opt) return *opt;
+    return {};
+}
+
+namespace detail {
+
+template< class, class = std::void_t<> >
+struct is_optional_like : std::false_type { };
+
+template< class O >
+struct is_optional_like<O, std::void_t<decltype(bool(std::declval<O const&>().has_value())),
+                                       decltype(*std::declval<O const&>())>> : std::true_type { };
+
+template <class O>
+constexpr bool is_optional_like_v = is_optional_like<std::remove_cvref_t<O>>::value;
+
+template <class C>
+using range_element_t = std::remove_cvref_t<decltype(*std::begin(std::declval<C&>()))>;
+
+template <class O>
+using optional_value_t = std::remove_cvref_t<decltype(*std::declval<O const&>())>;
+
+template <class T>
+using blend_bits_t = std::conditional_t<sizeof(T) == 1, uint8_t,
+                     std::conditional_t<sizeof(T) == 2, uint16_t,
+                     std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>>;
+
+template <class T>
+constexpr bool is_blendable_v = std::is_arithmetic_v<T> && sizeof(T) <= sizeof(uint64_t);
+
+/* The value of an engaged optional, otherwise 'otherwise'.
+ * Arithmetic values of an Optional are selected with a bit mask built from
+ * the engaged flag, without a branch the loops over a range could miss.
+ * Rvalue optionals give up their value by move.
+ */
+template <class O, class T>
+constexpr auto strip_or(O&& o, const T& otherwise) {
+    using V = optional_value_t<O>;
+    if constexpr (is_optional_v<O> && is_blendable_v<V>
+                  && !std::is_reference_v<typename std::remove_cvref_t<O>::value_type>) {
+        using N = typename std::remove_cvref_t<O>::niche_type;
+        auto const& storage = optional_access::storage(o);
+        if constexpr (std::is_void_v<N>) {
+            using U = blend_bits_t<V>;
+            const V fallback = static_cast<V>(otherwise);
+            U value, other;
+            std::memcpy(&value, std::addressof(storage.value), sizeof(V));
+            std::memcpy(&other, &fallback, sizeof(V));
+            const U mask = U(0) - U(storage.engaged);
+            const U bits = static_cast<U>((value & mask) | (other & ~mask));
+            V out;
+            std::memcpy(&out, &bits, sizeof(V));
+            return out;
+        }
+        else
+            return storage.has_value() ? storage.value : static_cast<V>(otherwise);
+    }
+    else if constexpr (std::is_rvalue_reference_v<O&&>)
+        return o.has_value() ? V(std::move(*o)) : V(otherwise);
+    else
+        return o.has_value() ? V(*o) : V(otherwise);
+}
+
+}
+
+/* strip_iterator(I, I, O, V) -> O
+ *
+ * Bulk 'strip' of the optionals in [begin, end) into the output iterator,
+ * replacing disengaged optionals by 'otherwise'. Optionals are moved from
+ * given move iterators.
+ */
+template <typename It, typename Out, typename T>
+Out strip_iterator(It begin, It end, Out out, const T& otherwise) {
+    for (; begin != end; ++begin, ++out)
+        *out = detail::strip_or(*begin, otherwise);
+    return out;
+}
+
+/* strip([A?], A) -> [A]
+ *
+ * Bulk 'strip' of a collection of f::Optional or std::optional into a dense
+ * vector, replacing disengaged optionals by 'otherwise'. The values of an
+ * rvalue collection are moved out.
+ */
+template <typename C, typename T>
+requires detail::is_optional_like_v<detail::range_element_t<C>>
+[[nodiscard]]
+auto strip(C&& opts, const T& otherwise) {
+    using V = detail::optional_value_t<detail::range_element_t<C>>;
+    std::vector<V> out;
+    const auto n = std::distance(std::begin(opts), std::end(opts));
+    if constexpr (detail::is_blendable_v<V>) {
+        out.resize(static_cast<size_t>(n));
+        strip_iterator(std::begin(opts), std::end(opts), out.begin(), otherwise);
+    }
+    else {
+        out.reserve(static_cast<size_t>(n));
+        if constexpr (std::is_rvalue_reference_v<C&&>)
+            strip_iterator(std::make_move_iterator(std::begin(opts)),
+                           std::make_move_iterator(std::end(opts)),
+                           std::back_inserter(out), otherwise);
+        else
+            strip_iterator(std::begin(opts), std::end(opts), std::back_inserter(out), otherwise);
+    }
+    return out;
+}
+
+/* 'strip' of a columnar OptionalVector, replacing disengaged elements by
+ * 'otherwise'. Words of the bitmap without disengaged elements are copied
+ * as is, the others select per element without branching.
+ */
+template <typename T>
+[[nodiscard]]
+std::vector<T> strip(OptionalVector<T> const& opts, const T& otherwise) {
+    using word_type = typename OptionalVector<T>::word_type;
+    constexpr size_t word_bits = OptionalVector<T>::word_bits;
+    const size_t n = opts.size();
+    std::vector<T> out(opts.values(), opts.values() + n);
+    for (size_t w = 0; w < OptionalVector<T>::words(n); w++) {
+        const word_type bits = opts.bitmap()[w];
+        if (bits == ~word_type{0})
+            continue;
+        const size_t base = w * word_bits;
+        const size_t end = std::min(n, base + word_bits);
+        for (size_t i = base; i < end; i++)
+            out[i] = (bits >> (i - base)) & 1 ? out[i] : otherwise;
+    }
+    return out;
+}
+
+namespace detail {
+
+/* A composed callable is stored as a base class when it is empty, so a
+ * composition of stateless callables takes up no storage.
+ */
+template <size_t I, class F, bool = std::is_empty_v<F> && !std::is_final_v<F>>
+struct compose_leaf : F {
+    template <class G>
+    requires (!std::is_same_v<std::remove_cvref_t<G>, compose_leaf>)
+    constexpr compose_leaf(G&& g) : F(std::forward<G>(g)) {}
+    constexpr F const& get(void) const noexcept { return *this; }
+    constexpr F& get(void) noexcept { return *this; }
+};
+
+template <size_t I, class F>
+struct compose_leaf<I, F, false> {
+    template <class G>
+    requires (!std::is_same_v<std::remove_cvref_t<G>, compose_leaf>)
+    constexpr compose_leaf(G&& g) : f(std::forward<G>(g)) {}
+    constexpr F const& get(void) const noexcept { return f; }
+    constexpr F& get(void) noexcept { return f; }
+    F f;
+};
+
+template <class Is, class... Fs>
+class Composition;
+
+template <size_t... Is, class... Fs>
+class Composition<std::index_sequence<Is...>, Fs...> : compose_leaf<Is, Fs>... {
+public:
+    template <class... Gs>
+    requires (sizeof...(Gs) == sizeof...(Fs)
+              && !(std::is_same_v<std::remove_cvref_t<Gs>, Composition> || ...))
+    constexpr explicit Composition(Gs&&... gs) : compose_leaf<Is, Fs>(std::forward<Gs>(gs))... {}
+
+    template <class... Xs>
+    constexpr decltype(auto) operator()(Xs&&... xs) const {
+        return call<0>(*this, std::forward<Xs>(xs)...);
+    }
+
+    template <class... Xs>
+    constexpr decltype(auto) operator()(Xs&&... xs) {
+        return call<0>(*this, std::forward<Xs>(xs)...);
+    }
+
+private:
+    template <size_t I, class Self, class... Xs>
+    static constexpr decltype(auto) call(Self& self, Xs&&... xs) {
+        using leaf = compose_leaf<I, std::tuple_element_t<I, std::tuple<Fs...>>>;
+        auto& f = static_cast<std::conditional_t<std::is_const_v<Self>,
+                                                 leaf const&, leaf&>>(self).get();
+        if constexpr (I + 1 == sizeof...(Fs))
+            return std::invoke(f, std::forward<Xs>(xs)...);
+        else
+            return call<I + 1>(self, std::invoke(f, std::forward<Xs>(xs)...));
+    }
+};
+
+}
+
+/* F(x) G(y) -> G(F(x))
+ *
+ * compose models a joined transformation of input given transformers
+ * joined together, applied from left to right:
+ *
+ * compose(f, g, h)(x) -> h(g(f(x)))
+ *
+ * The transformers are stored flat in the composition, and stateless
+ * transformers take up no storage. The composition is constexpr and fully
+ * inlined, with no overhead compared to calling the transformers by hand.
+ */
+template <class F, class... Fs>
+constexpr auto compose(F&& f, Fs&&... fs) {
+    return detail::Composition<std::index_sequence_for<F, Fs...>,
+                               std::decay_t<F>, std::decay_t<Fs>...>(
+        std::forward<F>(f), std::forward<Fs>(fs)...);
+}
+
+namespace detail {
+
+template <class F>
+struct ThenStep {
+    [[no_unique_address]] F f;
+};
+
+template <class P>
+struct WhenStep {
+    [[no_unique_address]] P p;
+};
+
+template <class>
+struct is_chain_step : std::false_type {};
+template <class F>
+struct is_chain_step<ThenStep<F>> : std::true_type {};
+template <class P>
+struct is_chain_step<WhenStep<P>> : std::true_type {};
+
+template <class S>
+constexpr bool is_chain_step_v = is_chain_step<std::remove_cvref_t<S>>::value;
+
+template <class>
+struct is_when_step : std::false_type {};
+template <class P>
+struct is_when_step<WhenStep<P>> : std::true_type {};
+
+/* The value an Optional holds, or R itself for a plain value.
+ */
+template <class R, class = void>
+struct unwrap_optional { using type = R; };
+template <class R>
+struct unwrap_optional<R, std::enable_if_t<is_optional_v<R>>> {
+    using type = decltype(*std::declval<R>());
+};
+
+/* Type of the value after applying the chain steps to a V.
+ */
+template <class V, class... Steps>
+struct chain_value { using type = V; };
+
+template <class V, class F, class... Steps>
+struct chain_value<V, ThenStep<F>, Steps...>
+    : chain_value<typename unwrap_optional<std::invoke_result_t<F const&, V>>::type, Steps...> {};
+
+template <class V, class P, class... Steps>
+struct chain_value<V, WhenStep<P>, Steps...> : chain_value<V, Steps...> {};
+
+/* Monadic chain of steps applied to an Optional, evaluated once converted
+ * to an Optional. O is a const reference to an lvalue source, or the
+ * source itself. Value steps run straight after the single engagement
+ * check of the source, and the result is constructed in place, so a chain
+ * of value steps compiles to one branch without intermediate Optionals.
+ */
+template <class O, class... Steps>
+class OptionalChain {
+public:
+    using source_type = std::remove_cvref_t<O>;
+    using value_type = std::remove_cvref_t<
+        typename chain_value<decltype(*std::declval<const source_type&>()), Steps...>::type>;
+    using result_type = Optional<value_type>;
+
+    template <class S>
+    constexpr OptionalChain(S&& source, std::tuple<Steps...> steps)
+        : m_source(std::forward<S>(source)), m_steps(std::move(steps)) {}
+
+    template <class S>
+    requires is_chain_step_v<S>
+    constexpr auto then(S&& step) && {
+        return OptionalChain<O, Steps..., std::remove_cvref_t<S>>(
+            std::forward<O>(m_source),
+            std::tuple_cat(std::move(m_steps), std::make_tuple(std::forward<S>(step))));
+    }
+
+    constexpr result_type evaluate(void) const {
+        return run([](auto&& v) { return result_type(in_place, std::forward<decltype(v)>(v)); },
+                   [] { return result_type(); });
+    }
+
+    constexpr operator result_type(void) const { return evaluate(); }
+
+    template <class U>
+    constexpr value_type get_value_or(U&& other) const {
+        return run([](auto&& v) { return value_type(std::forward<decltype(v)>(v)); },
+                   [&] { return static_cast<value_type>(std::forward<U>(other)); });
+    }
+
+private:
+    template <class Done, class Empty>
+    constexpr auto run(Done&& done, Empty&& empty) const {
+        if (!m_source)
+            return empty();
+        return step<0>(*m_source, done, empty);
+    }
+
+    template <size_t I, class V, class Done, class Empty>
+    constexpr auto step(V&& v, Done& done, Empty& empty) const {
+        if constexpr (I == sizeof...(Steps))
+            return done(std::forward<V>(v));
+        else {
+            const auto& s = std::get<I>(m_steps);
+            if constexpr (is_when_step<std::remove_cvref_t<decltype(s)>>::value) {
+                if (!std::invoke(s.p, std::as_const(v)))
+                    return empty();
+                return step<I + 1>(std::forward<V>(v), done, empty);
+            }
+            else {
+                decltype(auto) r = std::invoke(s.f, std::forward<V>(v));
+                if constexpr (is_optional_v<decltype(r)>) {
+                    if (!r)
+                        return empty();
+                    return step<I + 1>(*std::move(r), done, empty);
+                }
+                else
+                    return step<I + 1>(std::forward<decltype(r)>(r), done, empty);
+            }
+        }
+    }
+
+    O m_source;
+    std::tuple<Steps...> m_steps;
+};
+
+template <class>
+struct is_optional_chain : std::false_type {};
+template <class O, class... Steps>
+struct is_optional_chain<OptionalChain<O, Steps...>> : std::true_type {};
+
 }
 
-template <typename T>
-[[nodiscard]]
-constexpr inline T strip(Lazy<T> opt) {
-    if (opt) return *opt;
-    return {};
+/* A -> B?
+ *
+ * 'then' models a step of a monadic chain on an optional:
+ * opt | then(f) | then(g) applies f then g to the value of an engaged opt.
+ * A step returning an Optional ends the chain disengaged when it is
+ * disengaged, a step returning a plain value continues with it.
+ */
+template <class F>
+constexpr auto then(F&& f) {
+    return detail::ThenStep<std::decay_t<F>>{std::forward<F>(f)};
 }
 
-/* F(x) G(y) -> F(G(Y))
+/* A -> bool
  *
- * compose models a joined transformation of input given transformers
- * joined together.
+ * 'when' models a filtering step of a monadic chain on an optional, ending
+ * the chain disengaged for a value not satisfying the predicate P.
  */
-/*
-template <typename F>
-auto compose(F f) {
-    return [=] (auto x) { return f(x); };
+template <class P>
+constexpr auto when(P&& p) {
+    return detail::WhenStep<std::decay_t<P>>{std::forward<P>(p)};
 }
 
-template <typename F, typename... Fs>
-auto compose(F&& f, Fs&&... fs) {
-    //return [=] (auto x) { return f(compose(fs...)(x)); };
-    return [=] (auto x) { return std::invoke(f, (compose(std::forward(fs)...))(x)); };
+template <class O, class S>
+requires (detail::is_optional_v<O> && detail::is_chain_step_v<S>)
+constexpr auto operator|(O&& opt, S&& step) {
+    using source = std::conditional_t<std::is_lvalue_reference_v<O>,
+                                      const std::remove_cvref_t<O>&, std::remove_cvref_t<O>>;
+    return detail::OptionalChain<source>(std::forward<O>(opt), std::tuple<>{}).then(std::forward<S>(step));
 }
-*/
 
-template <class F, class... Fs>
-auto compose(F&& f, Fs&& ...fs)
-{
-    return [ f = std::forward(f), ... fs = std::forward(fs) ]
-        <class... Xs>(Xs&& ...xs) mutable {
-        return compose(std::forward(fs)...)(std::invoke(std::forward(f), std::forward(xs)...));
-    };
+template <class C, class S>
+requires (detail::is_optional_chain<C>::value && detail::is_chain_step_v<S>)
+constexpr auto operator|(C&& chain, S&& step) {
+    return std::move(chain).then(std::forward<S>(step));
 }
 
 /* for_each collection traversal.
  *
  * Linearly evaluate function F on all values in a collection.
+ * Lazy collections are evaluated in the same single traversal.
  */
 template <typename F, typename It>
 constexpr void for_each_iterator(F&& f, It begin, It end) {
@@ -147,8 +1139,11 @@ constexpr void for_each_iterator(F&& f, It begin, It end) {
 }
 
 template <typename F, typename Arr>
-constexpr inline void for_each(F f, Arr& arr) {
-    for_each_iterator(f, arr.begin(), arr.end());
+constexpr inline void for_each(F f, Arr&& arr) {
+    if constexpr (detail::is_lazy_collection_v<Arr>)
+        arr.traverse([&](auto&& e) { f(std::forward<decltype(e)>(e)); return true; });
+    else
+        for_each_iterator(f, arr.begin(), arr.end());
 }
 
 
@@ -165,6 +1160,8 @@ constexpr inline void for_each(F f, Arr& arr) {
  * a = [1 2 3]
  * sum = foldl(+, 0, a) -> (0 + (1 + (2 + (3))))
  * 
+ * foldl of a lazy collection is evaluated in a single traversal without
+ * materializing the collection.
  */
 template <typename V, typename F, typename It>
 [[nodiscard]]
@@ -177,9 +1174,32 @@ constexpr auto fold_iterator(F f, V init, It begin, It end) -> V {
 template <typename V, typename F, typename Arr>
 [[nodiscard]]
 constexpr auto foldl(F f, const V init, Arr arr) -> V {
-    if (arr.begin() >= arr.end())
-        return init; 
-    return fold_iterator(f, f(init, *arr.begin()), arr.begin()+1, arr.end());
+    if constexpr (detail::is_lazy_collection_v<Arr>) {
+        V acc = init;
+        arr.traverse([&](auto&& e) {
+            acc = f(std::move(acc), std::forward<decltype(e)>(e));
+            return true;
+        });
+        return acc;
+    }
+    else {
+        if (arr.begin() >= arr.end())
+            return init; 
+        return fold_iterator(f, f(init, *arr.begin()), arr.begin()+1, arr.end());
+    }
+}
+
+/* foldl of a columnar OptionalVector folds the engaged elements only.
+ */
+template <typename V, typename F, typename T>
+[[nodiscard]]
+auto foldl(F f, const V init, OptionalVector<T> const& opts) -> V {
+    V acc = init;
+    const T* values = opts.values();
+    opts.for_each_engaged([&](size_t i) {
+        acc = f(std::move(acc), values[i]);
+    });
+    return acc;
 }
 
 template <typename V, typename F, typename Arr>
@@ -190,6 +1210,29 @@ constexpr auto foldr(F f, const V init, Arr arr) -> V {
     return fold_iterator(f, f(init, *arr.rbegin()), arr.rbegin()+1, arr.rend());
 }
 
+/* scanl(F, V, C) -> [F(V, c0), F(F(V, c0), c1), ...]
+ *
+ * scan expressions models the fold expression, but keeps every intermediate
+ * value of the fold, such as the running sum:
+ *
+ * a = [1 2 3]
+ * sums = scanl(+, 0, a) -> [1 3 6]
+ */
+template <typename V, typename F, typename Arr>
+[[nodiscard]]
+auto scanl(F f, const V init, Arr const& arr) -> std::vector<V> {
+    std::vector<V> out;
+    if constexpr (detail::has_size_hint_v<Arr>)
+        out.reserve(detail::size_hint(arr));
+    V acc = init;
+    detail::traverse(arr, [&](auto&& e) {
+        acc = f(std::move(acc), std::forward<decltype(e)>(e));
+        out.push_back(acc);
+        return true;
+    });
+    return out;
+}
+
 
 /* F(A) -> B
  *
@@ -213,8 +1256,185 @@ fmap(F &&f, TOpts&&... opts)
  * function into an output collection.
  */
 template<typename F, typename C>
-auto fmap(F&& f, C const& in) -> LazyTransformation<C, F> {
-    return LazyTransformation<C, F>(in, f);
+auto fmap(F&& f, C const& in) -> LazyTransformation<C, std::decay_t<F>> {
+    return LazyTransformation<C, std::decay_t<F>>(in, std::forward<F>(f));
+}
+
+/* F([A?]) -> [B?]
+ *
+ * fmap of a columnar OptionalVector transforms the engaged elements into a
+ * new OptionalVector with the same engagement. It is evaluated eagerly.
+ */
+template<typename F, typename A>
+auto fmap(F&& f, OptionalVector<A> const& in)
+    -> OptionalVector<std::remove_cvref_t<std::invoke_result_t<F&, A const&>>> {
+    using B = std::remove_cvref_t<std::invoke_result_t<F&, A const&>>;
+    OptionalVector<B> out(in.size());
+    std::copy(in.bitmap(), in.bitmap() + OptionalVector<A>::words(in.size()), out.bitmap());
+    const A* values = in.values();
+    B* mapped = out.values();
+    in.for_each_engaged([&](size_t i) {
+        mapped[i] = std::invoke(f, values[i]);
+    });
+    return out;
+}
+
+/* F([A]) -> [B]
+ *
+ * flat_map models the transformation of input collection given a transformer
+ * function producing a collection per element, into the concatenation of the
+ * produced collections.
+ */
+template<typename F, typename C>
+auto flat_map(F&& f, C const& in) -> LazyFlatTransformation<C, std::decay_t<F>> {
+    return LazyFlatTransformation<C, std::decay_t<F>>(in, std::forward<F>(f));
+}
+
+/* F([A], [B], ...) -> [C]
+ *
+ * zip_with models the elementwise transformation of several input collections
+ * given a transformer function taking one element of each collection.
+ */
+template<typename F, typename... Cs>
+auto zip_with(F&& f, Cs const&... in) -> LazyZipTransformation<std::decay_t<F>, Cs...> {
+    return LazyZipTransformation<std::decay_t<F>, Cs...>(std::forward<F>(f), in...);
+}
+
+/* F([A]) -> [B]
+ *
+ * fmap_memo models the transformation of input collection given an expensive
+ * transformer function, where each transformed element is evaluated at most
+ * once no matter how often the result is traversed.
+ */
+template<typename F, typename C>
+auto fmap_memo(F&& f, C const& in) -> LazyMemoTransformation<C, std::decay_t<F>> {
+    return LazyMemoTransformation<C, std::decay_t<F>>(in, std::forward<F>(f));
+}
+
+/* P([A]) -> [A]
+ *
+ * filter models the selection of the elements in a collection that satisfy
+ * the predicate P.
+ */
+template<typename P, typename C>
+auto filter(P&& p, C const& in) -> LazyFilter<C, std::decay_t<P>> {
+    return LazyFilter<C, std::decay_t<P>>(in, std::forward<P>(p));
+}
+
+/* N([A]) -> [A]
+ *
+ * take models the first N elements of a collection.
+ */
+template<typename C>
+auto take(size_t n, C const& in) -> LazyTake<C> {
+    return LazyTake<C>(in, n);
+}
+
+/* N([A]) -> [A]
+ *
+ * drop models a collection without its first N elements.
+ */
+template<typename C>
+auto drop(size_t n, C const& in) -> LazyDrop<C> {
+    return LazyDrop<C>(in, n);
+}
+
+/* P([A]) -> [A]
+ *
+ * take_while models the leading elements of a collection that satisfy
+ * the predicate P.
+ */
+template<typename P, typename C>
+auto take_while(P&& p, C const& in) -> LazyTakeWhile<C, std::decay_t<P>> {
+    return LazyTakeWhile<C, std::decay_t<P>>(in, std::forward<P>(p));
+}
+
+/* N([A]) -> [A]
+ *
+ * stride models every N'th element of a collection.
+ */
+template<typename C>
+auto stride(size_t n, C const& in) -> LazyStride<C> {
+    return LazyStride<C>(in, n);
+}
+
+
+namespace detail {
+
+/* Elementwise arithmetic applies to indexed lazy collections, combined with
+ * other indexed collections or scalars.
+ */
+template <class L, class R>
+constexpr bool is_elementwise_v =
+    (is_lazy_collection_v<L> || is_lazy_collection_v<R>)
+    && (is_indexed_v<L> || std::is_arithmetic_v<L>)
+    && (is_indexed_v<R> || std::is_arithmetic_v<R>);
+
+template <class Op, class L, class R>
+constexpr auto elementwise(Op op, L const& l, R const& r) {
+    if constexpr (std::is_arithmetic_v<L>)
+        return fmap([op, l](auto const& x) { return op(l, x); }, r);
+    else if constexpr (std::is_arithmetic_v<R>)
+        return fmap([op, r](auto const& x) { return op(x, r); }, l);
+    else
+        return zip_with(op, l, r);
+}
+
+struct maximum {
+    template <class L, class R>
+    constexpr auto operator()(L const& l, R const& r) const { return l < r ? r : l; }
+};
+
+struct minimum {
+    template <class L, class R>
+    constexpr auto operator()(L const& l, R const& r) const { return r < l ? r : l; }
+};
+
+}
+
+/* [A] + [B] -> [C]
+ *
+ * Elementwise arithmetic on indexed lazy collections builds an expression of
+ * lazy collections at compile time, e.g.
+ *
+ * c = fmap(f, a) + b * 2.0
+ *
+ * The expression is evaluated in a single fused loop when assigned to a typed
+ * collection value, without any temporary collection per operator.
+ */
+template <class L, class R, std::enable_if_t<detail::is_elementwise_v<L, R>, int> = 0>
+constexpr auto operator+(L const& l, R const& r) {
+    return detail::elementwise(std::plus<>{}, l, r);
+}
+
+template <class L, class R, std::enable_if_t<detail::is_elementwise_v<L, R>, int> = 0>
+constexpr auto operator-(L const& l, R const& r) {
+    return detail::elementwise(std::minus<>{}, l, r);
+}
+
+template <class L, class R, std::enable_if_t<detail::is_elementwise_v<L, R>, int> = 0>
+constexpr auto operator*(L const& l, R const& r) {
+    return detail::elementwise(std::multiplies<>{}, l, r);
+}
+
+template <class L, class R, std::enable_if_t<detail::is_elementwise_v<L, R>, int> = 0>
+constexpr auto operator/(L const& l, R const& r) {
+    return detail::elementwise(std::divides<>{}, l, r);
+}
+
+template <class C, std::enable_if_t<detail::is_elementwise_v<C, int>, int> = 0>
+constexpr auto operator-(C const& c) {
+    return fmap(std::negate<>{}, c);
+}
+
+template <class L, class R, std::enable_if_t<detail::is_elementwise_v<L, R>, int> = 0>
+constexpr auto max(L const& l, R const& r) {
+    return detail::elementwise(detail::maximum{}, l, r);
+}
+
+template <class L, class R, std::enable_if_t<detail::is_elementwise_v<L, R>, int> = 0>
+constexpr auto min(L const& l, R const& r) {
+    return detail::elementwise(detail::minimum{}, l, r);
 }
 
 
@@ -265,101 +1485,389 @@ namespace fp {
 // https://geo-ant.github.io/blog/2020/optional-pipe-syntax-part-3/
 // https://pfultz2.com/blog/2014/09/05/pipable-functions/
 
-/*
-template <typename T>
-using Sink = std::function<void(const T&)>;
+namespace detail {
 
-template <typename T>
-using Source = std::function<void(Sink<T>)>;
+/* Pipes are push-based: a source pushes each element into the pipeline,
+ * every pipe pushes its results into the next stage, and a sink consumes
+ * them. All stages are statically typed and connected by reference, so the
+ * whole pipeline is inlined without type-erasure or allocation per element.
+ */
+struct pipe_tag {};
+struct sink_tag {};
+struct source_tag {};
 
-template <typename T>
-void connect(Source<T> so, Sink<T> si) {
-    so(si);
-}
+/* Stages declare their kind by a 'category' tag rather than a common base, so
+ * stateless stages chained together stay empty.
+ */
+template< class, class = std::void_t<> >
+struct category { using type = void; };
 
-template <typename A, typename B>
-using Transform = std::function<void(Sink<B>, A)>;
+template< class T >
+struct category<T, std::void_t<typename T::category>> { using type = typename T::category; };
 
-template <typename A, typename B>
-void apply_to_sink(Transform<A, B> tf, Sink<A> si) {
-    tf(si);
-}
+template <class T>
+constexpr bool is_pipe_v = std::is_same_v<typename category<std::remove_cvref_t<T>>::type, pipe_tag>;
 
-template <typename A, typename B>
-void apply_to_source(Transform<A, B> tf, Source<A> so) {
-    tf(so);
+template <class T>
+constexpr bool is_sink_v = std::is_same_v<typename category<std::remove_cvref_t<T>>::type, sink_tag>;
+
+template <class T>
+constexpr bool is_source_v = std::is_same_v<typename category<std::remove_cvref_t<T>>::type, source_tag>;
+
+/* Once a source has pushed all of its elements, it finishes the pipeline.
+ * Stages that buffer elements implement finish() to flush them, other stages
+ * pass the finish on to the next stage.
+ */
+template< class, class = std::void_t<> >
+struct has_finish : std::false_type { };
+
+template< class S >
+struct has_finish<S, std::void_t<decltype(std::declval<S&>().finish())>> : std::true_type { };
+
+template< class, class, class = std::void_t<> >
+struct has_pipe_finish : std::false_type { };
+
+template< class P, class N >
+struct has_pipe_finish<P, N, std::void_t<decltype(std::declval<P&>().finish(std::declval<N&>()))>>
+    : std::true_type { };
+
+template <class S>
+constexpr void finish(S& sink) {
+    if constexpr (has_finish<S>::value)
+        sink.finish();
 }
-template <typename A, typename B>
-void operator>>(Transform<A, B> tf, Source<A> so) {
-    apply_to_source(tf, so);
+
+template <class P, class N>
+constexpr void finish(P& pipe, N& next) {
+    if constexpr (has_pipe_finish<P, N>::value)
+        pipe.finish(next);
+    else
+        finish(next);
 }
 
-template <typename A, typename B>
-void operator>>(Transform<A, B> tf, Sink<A> si) {
-    apply_to_sink(tf, si);
 }
 
-template <typename T>
-void operator>>(Source<T> so, Sink<T> si) {
-    connect(so, si);
+/* 'ConnectedSink' is the sink made from pipe P pushing into the sink S.
+ */
+template <typename P, typename S>
+class ConnectedSink {
+public:
+    using category = detail::sink_tag;
+
+    template <typename Q, typename R>
+    constexpr ConnectedSink(Q&& pipe, R&& sink)
+        : pipe(std::forward<Q>(pipe)), sink(std::forward<R>(sink)) {}
+
+    template <typename T>
+    constexpr void push(T&& v) {
+        pipe.push(std::forward<T>(v), sink);
+    }
+
+    constexpr void finish(void) {
+        detail::finish(pipe, sink);
+    }
+
+private:
+    [[no_unique_address]] P pipe;
+    [[no_unique_address]] S sink;
+};
+
+namespace detail {
+
+/* A sink that only refers to pipes and sinks owned elsewhere is cheap to copy,
+ * and stays valid when copied to another thread. Chained pipes hold such sinks
+ * by value, and all other sinks by reference.
+ */
+template <class S>
+struct is_reference_sink : std::false_type { };
+
+template <class P, class S>
+struct is_reference_sink<ConnectedSink<P&, S&>> : std::true_type { };
+
+template <class P, class S>
+struct is_reference_sink<ConnectedSink<P&, S>> : is_reference_sink<S> { };
+
+template <class S>
+using sink_storage_t = std::conditional_t<is_reference_sink<S>::value, S, S&>;
+
 }
 
-struct pipe_base {};
+/* 'ChainPipe' is the pipe made from pipe A pushing into pipe B.
+ */
+template <typename A, typename B>
+class ChainPipe {
+public:
+    using category = detail::pipe_tag;
+
+    template <typename X, typename Y>
+    constexpr ChainPipe(X&& a, Y&& b) : a(std::forward<X>(a)), b(std::forward<Y>(b)) {}
+
+    template <typename T, typename Next>
+    constexpr void push(T&& v, Next& next) {
+        ConnectedSink<B&, detail::sink_storage_t<Next>> connected{b, next};
+        a.push(std::forward<T>(v), connected);
+    }
+
+    template <typename Next>
+    constexpr void finish(Next& next) {
+        ConnectedSink<B&, detail::sink_storage_t<Next>> connected{b, next};
+        detail::finish(a, connected);
+    }
+
+private:
+    [[no_unique_address]] A a;
+    [[no_unique_address]] B b;
+};
 
+/* F(A) -> B
+ *
+ * 'TransformPipe' pushes F(a) for each received a.
+ */
 template <typename F>
-class TransformPipe : public pipe_base {
+class TransformPipe {
 public:
-    explicit TransformPipe(F f) : f(f) {};
+    using category = detail::pipe_tag;
 
-    template <typename... V, typename P>
-    void onRecieve(V&&... v, P&& next) {
-        send(std::invoke(f, std::forward(v)...), next);
+    explicit constexpr TransformPipe(F f) : f(std::move(f)) {}
+
+    template <typename T, typename Next>
+    constexpr void push(T&& v, Next& next) {
+        next.push(std::invoke(f, std::forward<T>(v)));
     }
 
 private:
-    F f;
+    [[no_unique_address]] F f;
+};
+
+/* P(A) -> A
+ *
+ * 'FilterPipe' pushes each received a that satisfy the predicate P.
+ */
+template <typename P>
+class FilterPipe {
+public:
+    using category = detail::pipe_tag;
+
+    explicit constexpr FilterPipe(P p) : p(std::move(p)) {}
+
+    template <typename T, typename Next>
+    constexpr void push(T&& v, Next& next) {
+        if (std::invoke(p, std::as_const(v)))
+            next.push(std::forward<T>(v));
+    }
+
+private:
+    [[no_unique_address]] P p;
 };
 
+/* F(A)
+ *
+ * 'Sink' consumes each received a by calling F.
+ */
 template <typename F>
-TransformPipe<F> transform(F f) {
-    return TransformPipe<F>(f);
-}
+class Sink {
+public:
+    using category = detail::sink_tag;
 
-template <class F>
-struct PipeClosure : F {
-    template <class... Xs>
-    PipeClosure(Xs&&... xs) : F(std::forward(xs)...) {}
+    explicit constexpr Sink(F f) : f(std::move(f)) {}
+
+    template <typename T>
+    constexpr void push(T&& v) {
+        std::invoke(f, std::forward<T>(v));
+    }
+
+private:
+    [[no_unique_address]] F f;
 };
 
-template <typename T, typename F>
-decltype(auto) operator>>=(T&& c, const PipeClosure<F> p) {
-    return std::invoke(p, std::forward(p));
-}
+/* 'PushBackSink' appends each received a to the collection C.
+ */
+template <typename C>
+class PushBackSink {
+public:
+    using category = detail::sink_tag;
 
-template <class F>
-auto MakePipeClosure(F&& f) {
-    return PipeClosure<F>(std::move(f));
-}
+    explicit constexpr PushBackSink(C& c) : c(c) {}
+
+    template <typename T>
+    constexpr void push(T&& v) {
+        c.push_back(std::forward<T>(v));
+    }
 
+private:
+    C& c;
+};
 
-template <class F>
-struct Pipalbe {
-    template <class... Xs>
-    auto operator()(Xs&&... xs) {
-        return MakePipeClosure([=](auto x) -> decltype(auto) {
-            return F()(x, xs...);});
+/* 'TeeSink' pushes each received a into every one of the sinks Ss, so
+ * several results can be computed in a single traversal.
+ */
+template <typename... Ss>
+class TeeSink {
+public:
+    using category = detail::sink_tag;
+
+    template <typename... Rs>
+    explicit constexpr TeeSink(Rs&&... sinks) : sinks(std::forward<Rs>(sinks)...) {}
+
+    template <typename T>
+    constexpr void push(T&& v) {
+        std::apply([&](auto&... s) { (..., s.push(std::as_const(v))); }, sinks);
+    }
+
+    constexpr void finish(void) {
+        std::apply([](auto&... s) { (..., detail::finish(s)); }, sinks);
+    }
+
+private:
+    std::tuple<Ss...> sinks;
+};
+
+/* K(A) -> N
+ *
+ * 'DemuxSink' pushes each received a into the N'th of the sinks Ss, given
+ * the key function K. Elements with a key out of range are dropped.
+ */
+template <typename K, typename... Ss>
+class DemuxSink {
+public:
+    using category = detail::sink_tag;
+
+    template <typename G, typename... Rs>
+    explicit constexpr DemuxSink(G&& key, Rs&&... sinks)
+        : key(std::forward<G>(key)), sinks(std::forward<Rs>(sinks)...) {}
+
+    template <typename T>
+    constexpr void push(T&& v) {
+        const size_t n = static_cast<size_t>(std::invoke(key, std::as_const(v)));
+        std::apply([&](auto&... s) {
+            size_t i = 0;
+            (void)(... || (i++ == n && (s.push(std::forward<T>(v)), true)));
+        }, sinks);
+    }
+
+    constexpr void finish(void) {
+        std::apply([](auto&... s) { (..., detail::finish(s)); }, sinks);
+    }
+
+private:
+    [[no_unique_address]] K key;
+    std::tuple<Ss...> sinks;
+};
+
+/* 'Source' pushes each element of the collection C, which may be a lazy
+ * collection, into the connected sink.
+ */
+template <typename C>
+class Source {
+public:
+    using category = detail::source_tag;
+
+    explicit constexpr Source(C const& in) : in(in) {}
+
+    template <typename S>
+    constexpr void run(S& s) const {
+        f::detail::traverse(in, [&](auto&& e) {
+            s.push(std::forward<decltype(e)>(e));
+            return true;
+        });
+        detail::finish(s);
     }
+
+private:
+    f::detail::lazy_storage_t<C> in;
+};
+
+/* 'SourcePipe' is the source made from source S pushing through pipe P.
+ */
+template <typename S, typename P>
+class SourcePipe {
+public:
+    using category = detail::source_tag;
+
+    template <typename X, typename Y>
+    constexpr SourcePipe(X&& src, Y&& pipe)
+        : src(std::forward<X>(src)), pipe(std::forward<Y>(pipe)) {}
+
+    template <typename K>
+    constexpr void run(K& sink) {
+        ConnectedSink<P&, K&> connected{pipe, sink};
+        src.run(connected);
+    }
+
+private:
+    [[no_unique_address]] S src;
+    [[no_unique_address]] P pipe;
 };
 
+template <typename F>
+constexpr auto transform(F&& f) {
+    return TransformPipe<std::decay_t<F>>(std::forward<F>(f));
+}
+
+template <typename P>
+constexpr auto filter(P&& p) {
+    return FilterPipe<std::decay_t<P>>(std::forward<P>(p));
+}
+
+template <typename F>
+constexpr auto sink(F&& f) {
+    return Sink<std::decay_t<F>>(std::forward<F>(f));
+}
+
+template <typename C>
+constexpr auto push_back(C& c) {
+    return PushBackSink<C>(c);
+}
+
+template <typename... Ss>
+constexpr auto tee(Ss&&... sinks) {
+    return TeeSink<std::decay_t<Ss>...>(std::forward<Ss>(sinks)...);
+}
+
+template <typename K, typename... Ss>
+constexpr auto demux(K&& key, Ss&&... sinks) {
+    return DemuxSink<std::decay_t<K>, std::decay_t<Ss>...>(std::forward<K>(key),
+                                                           std::forward<Ss>(sinks)...);
+}
 
-template <typename C, typename P>
-C operator>>(C&& c, P&& p) {
-    using std::begin;
-    using std::end;
-    std::copy(
-        std::make_move_iterator(begin(c), std::make_move_iterator(end(c))),
-        p);
+/* P(A) -> A
+ *
+ * partition pushes each received a that satisfy the predicate P into the
+ * first sink, and all others into the second sink.
+ */
+template <typename P, typename S1, typename S2>
+constexpr auto partition(P&& p, S1&& accepted, S2&& rejected) {
+    return demux([p = std::forward<P>(p)](const auto& v) -> size_t { return std::invoke(p, v) ? 0 : 1; },
+                 std::forward<S1>(accepted), std::forward<S2>(rejected));
+}
+
+template <typename C>
+constexpr auto source(C const& in) {
+    return Source<C>(in);
+}
+
+/* source >> pipe >> ... >> sink
+ *
+ * Connect the stages of a pipeline. A pipeline is run once its source is
+ * connected to a sink. Pipes connected to other pipes or to sinks can be
+ * stored and reused with different sources. Any collection can be used
+ * directly as a source.
+ */
+template <typename L, typename R,
+          std::enable_if_t<detail::is_pipe_v<R> || detail::is_sink_v<R>, int> = 0>
+constexpr decltype(auto) operator>>(L&& l, R&& r) {
+    using LT = std::decay_t<L>;
+    using RT = std::decay_t<R>;
+    if constexpr (detail::is_pipe_v<L> && detail::is_pipe_v<R>)
+        return ChainPipe<LT, RT>(std::forward<L>(l), std::forward<R>(r));
+    else if constexpr (detail::is_pipe_v<L>)
+        return ConnectedSink<LT, RT>(std::forward<L>(l), std::forward<R>(r));
+    else if constexpr (detail::is_source_v<L> && detail::is_pipe_v<R>)
+        return SourcePipe<LT, RT>(std::forward<L>(l), std::forward<R>(r));
+    else if constexpr (detail::is_source_v<L>)
+        l.run(r);
+    else
+        return source(l) >> std::forward<R>(r);
 }
-*/
 
 }
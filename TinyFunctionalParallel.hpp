@@ -0,0 +1,1432 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "TinyFunctional.hpp"
+
+namespace f {
+
+namespace detail {
+
+/* Size of a cache line, used to keep data written by different threads
+ * on separate cache lines.
+ */
+constexpr size_t cache_line_size = 64;
+
+/* Waiting strategy for a thread that cannot make progress: spin briefly,
+ * then yield, and finally sleep so an idle stage does not occupy a core.
+ */
+class Backoff {
+public:
+    void wait(void) {
+        if (m_rounds >= 64)
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        else if (m_rounds >= 16)
+            std::this_thread::yield();
+        m_rounds++;
+    }
+    void reset(void) noexcept { m_rounds = 0; }
+private:
+    size_t m_rounds = 0;
+};
+
+}
+
+/**
+ * @brief Bounded lock-free single-producer/single-consumer ring buffer.
+ * One thread pushes and one other thread pops, elements are moved in batches.
+ * The producer and consumer indices live on separate cache lines, and each
+ * side keeps a cached copy of the other side's index so the shared index is
+ * only read when the cached one says the ring is full or empty.
+ * The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class SpscRing {
+public:
+    using value_type = T;
+
+    static_assert(std::is_default_constructible_v<T> && std::is_move_assignable_v<T>,
+                  "f::SpscRing requires default constructible, move assignable values");
+
+    /**@brief Constructor for a ring holding at least 'capacity' elements*/
+    explicit SpscRing(size_t capacity)
+        : m_mask(round_up(capacity) - 1), m_slots(new T[m_mask + 1]) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /**@brief Number of elements the ring can hold*/
+    size_t capacity(void) const noexcept { return m_mask + 1; }
+
+    /**
+     * @brief Approximate number of elements in the ring.
+     * Exact when called from the producer or consumer thread while the other
+     * side is idle.
+     */
+    size_t size(void) const noexcept {
+        return m_head.value.load(std::memory_order_acquire)
+             - m_tail.value.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Producer side: move up to n elements from items into the ring.
+     * @return the number of elements moved, 0 if the ring is full.
+     */
+    size_t push_batch(T* items, size_t n) {
+        const size_t head = m_head.value.load(std::memory_order_relaxed);
+        if (head - m_tail_cache.value + n > capacity())
+            m_tail_cache.value = m_tail.value.load(std::memory_order_acquire);
+        const size_t count = std::min(n, capacity() - (head - m_tail_cache.value));
+        for (size_t i = 0; i < count; i++)
+            m_slots[(head + i) & m_mask] = std::move(items[i]);
+        m_head.value.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * @brief Consumer side: move up to n elements from the ring into out.
+     * @return the number of elements moved, 0 if the ring is empty.
+     */
+    size_t pop_batch(T* out, size_t n) {
+        const size_t tail = m_tail.value.load(std::memory_order_relaxed);
+        if (m_head_cache.value - tail < n)
+            m_head_cache.value = m_head.value.load(std::memory_order_acquire);
+        const size_t count = std::min(n, m_head_cache.value - tail);
+        for (size_t i = 0; i < count; i++)
+            out[i] = std::move(m_slots[(tail + i) & m_mask]);
+        m_tail.value.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+private:
+    template <typename V>
+    struct alignas(detail::cache_line_size) Padded { V value{}; };
+
+    static size_t round_up(size_t n) {
+        size_t c = 1;
+        while (c < n)
+            c <<= 1;
+        return c;
+    }
+
+    size_t m_mask;                                  ///< capacity - 1
+    std::unique_ptr<T[]> m_slots;                   ///< element storage
+    Padded<std::atomic<size_t>> m_head;             ///< written by producer
+    Padded<size_t> m_tail_cache;                    ///< producer copy of tail
+    Padded<std::atomic<size_t>> m_tail;             ///< written by consumer
+    Padded<size_t> m_head_cache;                    ///< consumer copy of head
+};
+
+namespace detail {
+
+/* Unsigned integer word of exactly N bytes, void when there is none.
+ */
+template <size_t N>
+struct atomic_word_of { using type = void; };
+template <> struct atomic_word_of<2> { using type = uint16_t; };
+template <> struct atomic_word_of<4> { using type = uint32_t; };
+template <> struct atomic_word_of<8> { using type = uint64_t; };
+#if defined(__SIZEOF_INT128__)
+__extension__ typedef unsigned __int128 uint128_t;
+template <> struct atomic_word_of<16> { using type = uint128_t; };
+#else
+template <> struct atomic_word_of<16> { struct alignas(16) type { unsigned char bytes[16]; }; };
+#endif
+
+/* Smallest word holding N bytes.
+ */
+constexpr size_t atomic_word_size(size_t n) {
+    return n <= 2 ? 2 : n <= 4 ? 4 : n <= 8 ? 8 : 16;
+}
+
+/* Atomic word, std::atomic unless it is a 16 byte integer and the target
+ * has a 16 byte compare and swap (cmpxchg16b on x86-64, built with -mcx16),
+ * where std::atomic goes through libatomic and is not lock-free.
+ */
+template <class W>
+class AtomicWord {
+public:
+    static constexpr bool is_always_lock_free = std::atomic<W>::is_always_lock_free;
+
+    W load(std::memory_order order) const noexcept { return m_word.load(order); }
+    W exchange(W desired, std::memory_order order) noexcept {
+        return m_word.exchange(desired, order);
+    }
+    bool compare_exchange(W& expected, W desired, std::memory_order order) noexcept {
+        return m_word.compare_exchange_strong(expected, desired, order, std::memory_order_relaxed);
+    }
+private:
+    std::atomic<W> m_word{};
+};
+
+#if defined(__SIZEOF_INT128__) && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)
+template <>
+class AtomicWord<uint128_t> {
+public:
+    static constexpr bool is_always_lock_free = true;
+
+    // The __sync builtins are full barriers, the orders are only for the interface.
+    uint128_t load(std::memory_order) const noexcept {
+        return __sync_val_compare_and_swap(const_cast<uint128_t*>(&m_word), 0, 0);
+    }
+    uint128_t exchange(uint128_t desired, std::memory_order order) noexcept {
+        uint128_t expected = load(order);
+        while (!compare_exchange(expected, desired, order)) {}
+        return expected;
+    }
+    bool compare_exchange(uint128_t& expected, uint128_t desired, std::memory_order) noexcept {
+        const uint128_t seen = __sync_val_compare_and_swap(&m_word, expected, desired);
+        if (seen == expected)
+            return true;
+        expected = seen;
+        return false;
+    }
+private:
+    alignas(16) uint128_t m_word = 0;
+};
+#endif
+
+}
+
+/**
+ * @brief Lock-free single slot Optional shared between threads.
+ * The value and the engaged flag are packed into one atomic word of 2, 4,
+ * 8 or 16 bytes, so putting, taking and exchanging the value are a single
+ * atomic operation. The empty slot is the all zero word.
+ * Values are limited to 15 bytes: the flag takes a byte of the word, and
+ * no lock-free word is wider than 16 bytes.
+ * Values of 8 to 15 bytes use a 16 byte word and need a 16 byte compare and
+ * swap: on x86-64 build with -mcx16, else the class does not compile, since
+ * std::atomic would fall back to locks in libatomic.
+ */
+template <typename T>
+class AtomicOptional {
+public:
+    using value_type = T;
+
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "f::AtomicOptional requires trivially copyable values");
+    static_assert(sizeof(T) < 16,
+                  "f::AtomicOptional requires values smaller than 16 bytes, "
+                  "leaving a byte for the engaged flag");
+
+private:
+    using word_type = typename detail::atomic_word_of<detail::atomic_word_size(sizeof(T) + 1)>::type;
+
+public:
+    /**@brief Whether the operations never take a lock*/
+    static constexpr bool is_always_lock_free = detail::AtomicWord<word_type>::is_always_lock_free;
+
+    static_assert(is_always_lock_free,
+                  "f::AtomicOptional of this size needs a lock-free 16 byte compare and swap, "
+                  "build with -mcx16 on x86-64");
+
+    /**@brief Constructor for an empty slot*/
+    AtomicOptional(void) noexcept = default;
+    /**@brief Constructor for a slot holding v*/
+    explicit AtomicOptional(const T& v) noexcept { m_word.exchange(pack(v), std::memory_order_relaxed); }
+
+    AtomicOptional(const AtomicOptional&) = delete;
+    AtomicOptional& operator=(const AtomicOptional&) = delete;
+
+    /**
+     * @brief Put v in the slot if it is empty.
+     * @return true if v was put, false if the slot already held a value.
+     */
+    bool try_put(const T& v) noexcept {
+        word_type empty{};
+        return m_word.compare_exchange(empty, pack(v), std::memory_order_release);
+    }
+
+    /**
+     * @brief Take the value out of the slot, leaving it empty.
+     * @return the value, or a disengaged Optional if the slot was empty.
+     */
+    Optional<T> try_take(void) noexcept {
+        word_type w = m_word.load(std::memory_order_relaxed);
+        while (engaged(w)) {
+            if (m_word.compare_exchange(w, word_type{}, std::memory_order_acquire))
+                return unpack(w);
+        }
+        return Optional<T>();
+    }
+
+    /**
+     * @brief Replace the content of the slot with v.
+     * @return the previous content of the slot.
+     */
+    Optional<T> exchange(const Optional<T>& v) noexcept {
+        return unpack(m_word.exchange(v ? pack(*v) : word_type{}, std::memory_order_acq_rel));
+    }
+
+    /**@brief Snapshot of the slot, which other threads may change right after*/
+    Optional<T> load(void) const noexcept {
+        return unpack(m_word.load(std::memory_order_acquire));
+    }
+
+private:
+    static word_type pack(const T& v) noexcept {
+        word_type w{};
+        const unsigned char flag = 1;
+        std::memcpy(&w, std::addressof(v), sizeof(T));
+        std::memcpy(reinterpret_cast<unsigned char*>(&w) + sizeof(T), &flag, 1);
+        return w;
+    }
+    static bool engaged(const word_type& w) noexcept {
+        unsigned char flag;
+        std::memcpy(&flag, reinterpret_cast<const unsigned char*>(&w) + sizeof(T), 1);
+        return flag != 0;
+    }
+    static Optional<T> unpack(const word_type& w) noexcept {
+        if (!engaged(w))
+            return Optional<T>();
+        alignas(T) unsigned char bytes[sizeof(T)];
+        std::memcpy(bytes, &w, sizeof(T));
+        return Optional<T>(*std::launder(reinterpret_cast<T*>(bytes)));
+    }
+
+    detail::AtomicWord<word_type> m_word;   ///< packed value and engaged flag
+};
+
+
+class TaskGroup;
+
+/**
+ * @brief Unit of work scheduled on an Executor.
+ * Tasks are owned by the code that submits them and must stay alive until
+ * their TaskGroup has been waited on.
+ */
+struct Task {
+    void (*run)(Task*) = nullptr;  ///< function executing the task
+    TaskGroup* group = nullptr;    ///< group notified on completion
+};
+
+/**
+ * @brief Interface of the executors running the parallel algorithms.
+ * submit() schedules a task, and try_run_one() lets a waiting thread help
+ * by running one scheduled task, so nested parallel calls make progress
+ * without spawning additional threads.
+ */
+class Executor {
+public:
+    virtual ~Executor(void) = default;
+    /**@brief Number of threads running tasks*/
+    virtual size_t concurrency(void) const = 0;
+    /**@brief Schedule task t*/
+    virtual void submit(Task* t) = 0;
+    /**@brief Run one scheduled task if any, return whether a task was run*/
+    virtual bool try_run_one(void) = 0;
+    /**@brief Number of NUMA nodes the threads are spread over*/
+    virtual size_t nodes(void) const { return 1; }
+    /**@brief Schedule task t, preferably on a thread of NUMA node 'node'*/
+    virtual void submit_to(Task* t, size_t node) { (void)node; submit(t); }
+};
+
+/**
+ * @brief Fork-join group of tasks.
+ * wait() returns once every task run through the group has completed, the
+ * waiting thread runs scheduled tasks in the meantime.
+ */
+class TaskGroup {
+public:
+    explicit TaskGroup(Executor& executor) : m_executor(executor) {}
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    ~TaskGroup(void) { wait(); }
+
+    void run(Task* t) {
+        t->group = this;
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+        m_executor.submit(t);
+    }
+
+    void run(Task* t, size_t node) {
+        t->group = this;
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+        m_executor.submit_to(t, node);
+    }
+
+    void wait(void) {
+        detail::Backoff backoff;
+        while (m_pending.load(std::memory_order_acquire) != 0) {
+            if (m_executor.try_run_one())
+                backoff.reset();
+            else
+                backoff.wait();
+        }
+    }
+
+    /**@brief Execute task t and notify its group*/
+    static void execute(Task* t) {
+        TaskGroup* group = t->group;
+        t->run(t);
+        group->m_pending.fetch_sub(1, std::memory_order_release);
+    }
+
+private:
+    Executor& m_executor;
+    std::atomic<size_t> m_pending{0};
+};
+
+namespace detail {
+
+/* Chase-Lev work-stealing deque of a fixed capacity.
+ * The owning thread pushes and pops at the bottom, other threads steal from
+ * the top. A full deque refuses the push and the owner runs the task inline.
+ */
+class WorkDeque {
+public:
+    explicit WorkDeque(size_t capacity)
+        : m_mask(capacity - 1), m_tasks(new std::atomic<Task*>[capacity]) {}
+
+    bool push(Task* t) {
+        const int64_t b = m_bottom.load(std::memory_order_relaxed);
+        const int64_t top = m_top.load(std::memory_order_acquire);
+        if (b - top > static_cast<int64_t>(m_mask))
+            return false;
+        m_tasks[b & m_mask].store(t, std::memory_order_relaxed);
+        m_bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    Task* pop(void) {
+        const int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(b, std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_seq_cst);
+        if (top > b) {
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Task* t = m_tasks[b & m_mask].load(std::memory_order_relaxed);
+        if (top == b) {
+            if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                               std::memory_order_relaxed))
+                t = nullptr;
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return t;
+    }
+
+    Task* steal(void) {
+        int64_t top = m_top.load(std::memory_order_seq_cst);
+        const int64_t b = m_bottom.load(std::memory_order_seq_cst);
+        if (top >= b)
+            return nullptr;
+        Task* t = m_tasks[top & m_mask].load(std::memory_order_relaxed);
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                           std::memory_order_relaxed))
+            return nullptr;
+        return t;
+    }
+
+private:
+    alignas(cache_line_size) std::atomic<int64_t> m_top{0};
+    alignas(cache_line_size) std::atomic<int64_t> m_bottom{0};
+    size_t m_mask;
+    std::unique_ptr<std::atomic<Task*>[]> m_tasks;
+};
+
+}
+
+/**
+ * @brief NUMA topology of the machine: the cpus of every node.
+ * Discovered from /sys/devices/system/node on Linux. Machines without NUMA,
+ * or without the information, are described as a single node of all cpus.
+ */
+struct NumaTopology {
+    std::vector<std::vector<int>> cpus;  ///< cpus of each node
+
+    size_t nodes(void) const { return cpus.size(); }
+
+    static NumaTopology const& system(void) {
+        static const NumaTopology topology = discover();
+        return topology;
+    }
+
+    /**@brief Parse a cpu list of the form "0-3,8,10-11"*/
+    static std::vector<int> parse_list(std::string const& list) {
+        std::vector<int> out;
+        size_t pos = 0;
+        while (pos < list.size()) {
+            size_t end = list.find(',', pos);
+            if (end == std::string::npos)
+                end = list.size();
+            const std::string range = list.substr(pos, end - pos);
+            const size_t dash = range.find('-');
+            try {
+                const int first = std::stoi(range.substr(0, dash));
+                const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                for (int i = first; i <= last; i++)
+                    out.push_back(i);
+            }
+            catch (...) {}
+            pos = end + 1;
+        }
+        return out;
+    }
+
+    static NumaTopology discover(void) {
+        NumaTopology topology;
+#if defined(__linux__)
+        const std::string root = "/sys/devices/system/node/";
+        std::string online;
+        std::ifstream(root + "online") >> online;
+        for (const int node : parse_list(online)) {
+            std::string list;
+            std::ifstream(root + "node" + std::to_string(node) + "/cpulist") >> list;
+            std::vector<int> cpus = parse_list(list);
+            if (!cpus.empty())
+                topology.cpus.push_back(std::move(cpus));
+        }
+#endif
+        if (topology.cpus.empty()) {
+            topology.cpus.emplace_back();
+            for (unsigned i = 0; i < std::max(std::thread::hardware_concurrency(), 1u); i++)
+                topology.cpus.back().push_back(static_cast<int>(i));
+        }
+        return topology;
+    }
+};
+
+/**
+ * @brief Configuration of a ThreadPool.
+ */
+struct ThreadPoolConfig {
+    size_t threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    bool pin = false;              ///< pin worker i to cpus[i], or cpu i
+    std::vector<int> cpus = {};    ///< cpus used for pinning
+    size_t deque_capacity = 4096;  ///< tasks per worker deque
+    bool numa = false;             ///< spread workers over the NUMA nodes
+    NumaTopology topology = {};    ///< nodes used by numa, discovered when empty
+};
+
+/**
+ * @brief Work-stealing thread pool.
+ * Every worker owns a Chase-Lev deque, tasks submitted by a worker go to its
+ * own deque and idle workers steal from the others. Tasks submitted from
+ * outside the pool go through a shared injection queue.
+ * Workers are spawned lazily on the first submitted task, and sleep when
+ * there is no work.
+ * A numa pool splits its workers over the nodes of the topology, pinned to
+ * the cpus of their node when pin is set. Tasks submitted to a node are
+ * preferably run by its workers, which steal from their own node first.
+ */
+class ThreadPool : public Executor {
+public:
+    using Config = ThreadPoolConfig;
+
+    explicit ThreadPool(Config config = {}) : m_config(std::move(config)) {
+        m_config.threads = std::max<size_t>(m_config.threads, 1);
+        size_t capacity = 1;
+        while (capacity < m_config.deque_capacity)
+            capacity <<= 1;
+        for (size_t i = 0; i < m_config.threads; i++)
+            m_deques.push_back(std::make_unique<detail::WorkDeque>(capacity));
+        if (m_config.numa && m_config.topology.cpus.empty())
+            m_config.topology = NumaTopology::system();
+        const size_t nodes = m_config.numa
+            ? std::clamp<size_t>(m_config.topology.nodes(), 1, m_config.threads) : 1;
+        m_node_injected.resize(nodes);
+        for (size_t i = 0; i < m_config.threads; i++)
+            m_node_of.push_back(i * nodes / m_config.threads);
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool(void) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto& worker : m_workers)
+            worker.join();
+    }
+
+    size_t concurrency(void) const override { return m_config.threads; }
+
+    size_t nodes(void) const override { return m_node_injected.size(); }
+
+    void submit(Task* t) override {
+        std::call_once(m_spawned, [this] { spawn(); });
+        m_queued.fetch_add(1, std::memory_order_seq_cst);
+        if (current().pool == this) {
+            if (!m_deques[current().index]->push(t)) {
+                m_queued.fetch_sub(1, std::memory_order_relaxed);
+                TaskGroup::execute(t);
+                return;
+            }
+        }
+        else {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_injected.push_back(t);
+        }
+        wake();
+    }
+
+    void submit_to(Task* t, size_t node) override {
+        if (nodes() == 1 || (current().pool == this && m_node_of[current().index] == node % nodes())) {
+            submit(t);
+            return;
+        }
+        std::call_once(m_spawned, [this] { spawn(); });
+        m_queued.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_node_injected[node % nodes()].push_back(t);
+        }
+        wake();
+    }
+
+    bool try_run_one(void) override {
+        Task* t = take();
+        if (!t)
+            return false;
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+        TaskGroup::execute(t);
+        return true;
+    }
+
+private:
+    struct Worker {
+        ThreadPool* pool = nullptr;
+        size_t index = 0;
+    };
+
+    static Worker& current(void) {
+        static thread_local Worker worker;
+        return worker;
+    }
+
+    void wake(void) {
+        if (m_sleeping.load(std::memory_order_seq_cst) != 0) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_wake.notify_one();
+        }
+    }
+
+    void spawn(void) {
+        for (size_t i = 0; i < m_config.threads; i++)
+            m_workers.emplace_back([this, i] { work(i); });
+    }
+
+    void pin(size_t i) {
+#if defined(__linux__)
+        std::vector<int> cpus;
+        if (i < m_config.cpus.size())
+            cpus.push_back(m_config.cpus[i]);
+        else if (nodes() > 1)
+            cpus = m_config.topology.cpus[m_node_of[i]];
+        else
+            cpus.push_back(static_cast<int>(i));
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (const int cpu : cpus)
+            if (cpu >= 0 && cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+        (void)i;
+#endif
+    }
+
+    Task* take(void) {
+        const Worker& self = current();
+        const bool is_worker = self.pool == this;
+        if (is_worker)
+            if (Task* t = m_deques[self.index]->pop())
+                return t;
+        if (m_queued.load(std::memory_order_relaxed) == 0)
+            return nullptr;
+        const size_t node = is_worker ? m_node_of[self.index] : 0;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+            if (lock.owns_lock()) {
+                if (Task* t = pop_front(m_node_injected[node]))
+                    return t;
+                if (Task* t = pop_front(m_injected))
+                    return t;
+            }
+        }
+        // Steal from the own node first, then from the others.
+        const size_t n = m_deques.size();
+        const size_t start = is_worker ? self.index + 1 : 0;
+        for (size_t k = 0; k < n; k++)
+            if (m_node_of[(start + k) % n] == node)
+                if (Task* t = m_deques[(start + k) % n]->steal())
+                    return t;
+        for (size_t k = 0; k < n; k++)
+            if (m_node_of[(start + k) % n] != node)
+                if (Task* t = m_deques[(start + k) % n]->steal())
+                    return t;
+        if (nodes() > 1) {
+            std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+            if (lock.owns_lock())
+                for (auto& injected : m_node_injected)
+                    if (Task* t = pop_front(injected))
+                        return t;
+        }
+        return nullptr;
+    }
+
+    static Task* pop_front(std::deque<Task*>& queue) {
+        if (queue.empty())
+            return nullptr;
+        Task* t = queue.front();
+        queue.pop_front();
+        return t;
+    }
+
+    void work(size_t i) {
+        current() = Worker{this, i};
+        if (m_config.pin)
+            pin(i);
+        detail::Backoff backoff;
+        size_t idle = 0;
+        for (;;) {
+            if (try_run_one()) {
+                backoff.reset();
+                idle = 0;
+                continue;
+            }
+            if (++idle < 64) {
+                backoff.wait();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+            m_wake.wait(lock, [this] {
+                return m_stop || m_queued.load(std::memory_order_seq_cst) != 0;
+            });
+            m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+            if (m_stop)
+                return;
+            idle = 0;
+            backoff.reset();
+        }
+    }
+
+    Config m_config;
+    std::vector<std::unique_ptr<detail::WorkDeque>> m_deques;
+    std::vector<std::thread> m_workers;
+    std::once_flag m_spawned;
+    std::mutex m_mutex;                    ///< guards injection, sleep and stop
+    std::condition_variable m_wake;
+    std::deque<Task*> m_injected;          ///< tasks submitted from outside
+    std::vector<std::deque<Task*>> m_node_injected;  ///< tasks submitted to a node
+    std::vector<size_t> m_node_of;         ///< node of every worker
+    std::atomic<size_t> m_queued{0};       ///< tasks submitted but not taken
+    std::atomic<size_t> m_sleeping{0};
+    bool m_stop = false;
+};
+
+/**
+ * @brief The executor shared by all parallel algorithms by default.
+ * A work-stealing pool of one worker per hardware thread, so nested parallel
+ * calls share the same workers instead of oversubscribing the machine.
+ */
+inline Executor& default_executor(void) {
+    static ThreadPool pool;
+    return pool;
+}
+
+/**
+ * @brief Partitioning of the work of a parallel algorithm in chunks.
+ * 'fixed' splits the work in a few equally sized chunks, one task each. The
+ * chunks only depend on the size of the work, so the partitioning is
+ * deterministic.
+ * 'dynamic' splits the work in chunks of 'grain' elements, which a task per
+ * worker takes one at a time, balancing skewed per-element costs.
+ * 'numa' splits the work as 'fixed', and gives every NUMA node of the
+ * executor a contiguous run of chunks, scheduled on the workers of the node.
+ * Collections initialized by first_touch() with the same policy have the
+ * pages of those chunks on the same node. Without NUMA it is 'fixed'.
+ */
+enum class Partition { fixed, dynamic, numa };
+
+/**
+ * @brief Cancellation flag shared between a parallel algorithm and the
+ * threads that may cancel it.
+ */
+class CancellationToken {
+public:
+    CancellationToken(void) = default;
+    CancellationToken(const CancellationToken&) = delete;
+    CancellationToken& operator=(const CancellationToken&) = delete;
+
+    void cancel(void) { m_cancelled.store(true, std::memory_order_relaxed); }
+    void reset(void) { m_cancelled.store(false, std::memory_order_relaxed); }
+    bool cancelled(void) const { return m_cancelled.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> m_cancelled{false};
+};
+
+/**
+ * @brief Completion status of a cancellable parallel algorithm.
+ */
+enum class Status { completed, cancelled };
+
+/**
+ * @brief Result of a cancellable parallel algorithm, possibly partial.
+ * A cancelled algorithm skips the chunks not yet started, 'value' is the
+ * result over the 'processed' elements of the chunks that did run.
+ */
+template <class T>
+struct Partial {
+    T value;
+    Status status = Status::completed;
+    size_t processed = 0;
+
+    bool completed(void) const { return status == Status::completed; }
+    bool cancelled(void) const { return status == Status::cancelled; }
+};
+
+/**
+ * @brief Execution policy selecting the parallel overload of an algorithm.
+ * Runs on the default executor unless given one with on(), and splits the
+ * work in chunks of at least 'grain' elements, partitioned as 'partition'.
+ * A policy given a cancellation token with until(), or a deadline with
+ * before(), stops starting new chunks once cancelled or past the deadline.
+ * Only algorithms reporting a Status accept such a policy, foldl and fmap
+ * throw Error and their try_ overloads must be used instead.
+ * Cancellation is checked at chunk boundaries, so its latency is a chunk;
+ * the 'dynamic' partition bounds it by 'grain' elements.
+ */
+struct ParallelPolicy {
+    using clock = std::chrono::steady_clock;
+
+    Executor* executor = nullptr;
+    size_t grain = 1024;
+    Partition partition = Partition::fixed;
+    CancellationToken const* token = nullptr;
+    clock::time_point deadline = clock::time_point::max();
+
+    constexpr ParallelPolicy on(Executor& e) const {
+        ParallelPolicy p = *this;
+        p.executor = &e;
+        return p;
+    }
+    constexpr ParallelPolicy with_grain(size_t g) const {
+        ParallelPolicy p = *this;
+        p.grain = g == 0 ? 1 : g;
+        return p;
+    }
+    constexpr ParallelPolicy with_partition(Partition part) const {
+        ParallelPolicy p = *this;
+        p.partition = part;
+        return p;
+    }
+    constexpr ParallelPolicy until(CancellationToken const& t) const {
+        ParallelPolicy p = *this;
+        p.token = &t;
+        return p;
+    }
+    constexpr ParallelPolicy before(clock::time_point d) const {
+        ParallelPolicy p = *this;
+        p.deadline = d;
+        return p;
+    }
+    ParallelPolicy within(clock::duration timeout) const {
+        return before(clock::now() + timeout);
+    }
+    constexpr ParallelPolicy uncancellable(void) const {
+        ParallelPolicy p = *this;
+        p.token = nullptr;
+        p.deadline = clock::time_point::max();
+        return p;
+    }
+    constexpr bool cancellable(void) const {
+        return token || deadline != clock::time_point::max();
+    }
+    bool cancelled(void) const {
+        return (token && token->cancelled())
+            || (deadline != clock::time_point::max() && clock::now() >= deadline);
+    }
+    Executor& get_executor(void) const {
+        return executor ? *executor : default_executor();
+    }
+};
+
+/* The default parallel execution policy.
+ */
+inline constexpr ParallelPolicy par{};
+
+namespace detail {
+
+/* Chunk c of a plan covers [c * length, min(n, (c + 1) * length)), and is
+ * scheduled on NUMA node node(c).
+ */
+struct ChunkPlan {
+    size_t n;
+    size_t chunks;
+    size_t length;
+    size_t nodes = 1;
+
+    size_t node(size_t c) const { return c * nodes / chunks; }
+};
+
+/* The algorithms without a try_ overload cannot report a partial result,
+ * so passing them a policy with a cancellation token or deadline is an error.
+ */
+inline void check_uncancellable(ParallelPolicy const& policy, const char* algorithm) {
+    if (policy.cancellable())
+        throw Error(std::string(algorithm) + " cannot report cancellation, use its try_ overload");
+}
+
+/* Plan the chunks of [0, n) for the policy. Chunk lengths are a multiple of
+ * 'align' elements, a cache line for contiguous elements. Chunk boundaries
+ * are cache line aligned only if the first element is, otherwise neighbouring
+ * chunks share at most the one cache line across their boundary.
+ */
+inline ChunkPlan plan_chunks(ParallelPolicy const& policy, size_t n, size_t align = 1) {
+    if (n == 0)
+        return {0, 0, 0};
+    const size_t nodes = policy.partition == Partition::numa ? policy.get_executor().nodes() : 1;
+    size_t length = policy.grain;
+    if (policy.partition != Partition::dynamic) {
+        const size_t max_chunks = policy.get_executor().concurrency() * 4;
+        size_t chunks = std::clamp<size_t>(n / policy.grain, 1, max_chunks);
+        chunks = (chunks + nodes - 1) / nodes * nodes;
+        length = (n + chunks - 1) / chunks;
+    }
+    length = (length + align - 1) / align * align;
+    return {n, (n + length - 1) / length, length, nodes};
+}
+
+/* Number of elements of type T in a cache line.
+ */
+template <class T>
+constexpr size_t cache_line_elements = std::max<size_t>(cache_line_size / sizeof(T), 1);
+
+/* Alignment of the chunks of a collection, in elements.
+ */
+template <class C>
+constexpr size_t chunk_align_v =
+    cache_line_elements<std::remove_cvref_t<decltype(element(std::declval<C const&>(), 0))>>;
+
+/* Run body(chunk, begin, end) for each chunk of the plan on the executor of
+ * the policy and wait for all of them. The calling thread takes part.
+ * Chunks not yet started when the policy is cancelled are skipped.
+ */
+template <typename B>
+Status parallel_chunks(ParallelPolicy const& policy, ChunkPlan const& plan, B&& body) {
+    const bool cancellable = policy.cancellable();
+    std::atomic<bool> skipped{false};
+    const auto run_chunk = [&](size_t c) {
+        if (cancellable && policy.cancelled()) {
+            skipped.store(true, std::memory_order_relaxed);
+            return;
+        }
+        body(c, c * plan.length, std::min(plan.n, (c + 1) * plan.length));
+    };
+    const auto status = [&] {
+        return skipped.load(std::memory_order_relaxed) ? Status::cancelled : Status::completed;
+    };
+    if (plan.chunks == 0)
+        return Status::completed;
+    if (plan.chunks == 1) {
+        run_chunk(0);
+        return status();
+    }
+    using R = decltype(run_chunk);
+
+    Executor& executor = policy.get_executor();
+    if (plan.nodes > 1) {
+        struct NodeTask : Task {
+            R const* run_chunk;
+            size_t chunk;
+        };
+        std::vector<NodeTask> tasks(plan.chunks);
+        TaskGroup group(executor);
+        for (size_t c = 0; c < plan.chunks; c++) {
+            tasks[c].run = [](Task* base) {
+                NodeTask* self = static_cast<NodeTask*>(base);
+                (*self->run_chunk)(self->chunk);
+            };
+            tasks[c].run_chunk = &run_chunk;
+            tasks[c].chunk = c;
+            group.run(&tasks[c], plan.node(c));
+        }
+        group.wait();
+        return status();
+    }
+    std::atomic<size_t> next{0};
+    const bool dynamic = policy.partition == Partition::dynamic;
+    const size_t tasks_count = dynamic ? std::min(plan.chunks, executor.concurrency() + 1)
+                                       : plan.chunks;
+    struct ChunkTask : Task {
+        R const* run_chunk;
+        std::atomic<size_t>* next;
+        size_t chunk, chunks;
+    };
+    const auto execute = [](Task* base) {
+        ChunkTask* self = static_cast<ChunkTask*>(base);
+        if (!self->next)
+            (*self->run_chunk)(self->chunk);
+        else
+            for (size_t c; (c = self->next->fetch_add(1, std::memory_order_relaxed)) < self->chunks; )
+                (*self->run_chunk)(c);
+    };
+    std::vector<ChunkTask> tasks(tasks_count);
+    TaskGroup group(executor);
+    for (size_t t = 0; t < tasks_count; t++) {
+        tasks[t].run = execute;
+        tasks[t].run_chunk = &run_chunk;
+        tasks[t].next = dynamic ? &next : nullptr;
+        tasks[t].chunk = t;
+        tasks[t].chunks = plan.chunks;
+    }
+    for (size_t t = 1; t < tasks_count; t++)
+        group.run(&tasks[t]);
+    execute(&tasks[0]);
+    group.wait();
+    return status();
+}
+
+template <typename B>
+size_t parallel_chunks(ParallelPolicy const& policy, size_t n, B&& body) {
+    const ChunkPlan plan = plan_chunks(policy, n);
+    parallel_chunks(policy, plan, std::forward<B>(body));
+    return plan.chunks;
+}
+
+}
+
+/* for_each(P, F, C)
+ *
+ * Parallel for_each collection traversal: the collection is partitioned in
+ * chunks as given by the policy, which are traversed in parallel.
+ * Chunk lengths of contiguous elements are a multiple of a cache line, so
+ * writes through F from different chunks share at most the cache lines across
+ * chunk boundaries, and none when the collection is cache line aligned.
+ * The collection must be random access or an indexed lazy collection.
+ * Returns whether the traversal completed or was cancelled by the policy.
+ */
+template <typename F, typename It>
+Status for_each_iterator(ParallelPolicy const& policy, F f, It begin, It end) {
+    static_assert(std::is_base_of_v<std::random_access_iterator_tag,
+                                    typename std::iterator_traits<It>::iterator_category>,
+                  "parallel f::for_each_iterator requires random access iterators");
+    using T = typename std::iterator_traits<It>::value_type;
+    const size_t n = static_cast<size_t>(end - begin);
+    const auto plan = detail::plan_chunks(policy, n, detail::cache_line_elements<T>);
+    return detail::parallel_chunks(policy, plan, [&](size_t, size_t b, size_t e) {
+        for (size_t i = b; i < e; i++)
+            f(begin[i]);
+    });
+}
+
+template <typename F, typename Arr>
+Status for_each(ParallelPolicy const& policy, F f, Arr&& arr) {
+    using C = std::remove_cvref_t<Arr>;
+    static_assert(detail::is_indexed_v<C>,
+                  "parallel f::for_each requires a random access or indexed collection");
+    if constexpr (detail::is_lazy_collection_v<C>) {
+        const size_t n = detail::size_hint(arr);
+        return detail::parallel_chunks(policy, detail::plan_chunks(policy, n, detail::chunk_align_v<C>),
+                                [&](size_t, size_t b, size_t e) {
+            for (size_t i = b; i < e; i++)
+                f(arr[i]);
+        });
+    }
+    else
+        return for_each_iterator(policy, f, arr.begin(), arr.end());
+}
+
+/**
+ * @brief Allocator default-initializing the elements it constructs without
+ * arguments, leaving the pages of trivial elements untouched until written.
+ */
+template <class T>
+struct DefaultInitAllocator : std::allocator<T> {
+    template <class U>
+    struct rebind { using other = DefaultInitAllocator<U>; };
+
+    DefaultInitAllocator(void) = default;
+    template <class U>
+    DefaultInitAllocator(DefaultInitAllocator<U> const&) noexcept {}
+
+    template <class U, class... Args>
+    void construct(U* p, Args&&... args) {
+        if constexpr (sizeof...(Args) == 0)
+            ::new (static_cast<void*>(p)) U;
+        else
+            ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+};
+
+/**
+ * @brief Vector whose pages are placed by the first thread writing them.
+ */
+template <class T>
+using NumaVector = std::vector<T, DefaultInitAllocator<T>>;
+
+/* first_touch<T>(P, N, G) -> NumaVector<T>
+ *
+ * Parallel initializer: the element i of the N elements is G(i), written
+ * in the same chunks as a parallel algorithm with policy P traverses them.
+ * With a 'numa' policy every page is first touched, and so placed, on the
+ * node that later processes it.
+ */
+template <typename T, typename G>
+NumaVector<T> first_touch(ParallelPolicy const& policy, size_t n, G gen) {
+    NumaVector<T> out;
+    out.resize(n);
+    const auto plan = detail::plan_chunks(policy, n, detail::cache_line_elements<T>);
+    detail::parallel_chunks(policy, plan, [&](size_t, size_t b, size_t e) {
+        for (size_t i = b; i < e; i++)
+            out[i] = gen(i);
+    });
+    return out;
+}
+
+/* foldl(P, F, V, C)
+ *
+ * Parallel fold expression: the collection is split in chunks that are
+ * folded in parallel from V, and the partial results are folded with F.
+ * F must be associative and V must be an identity of F, e.g. + and 0.
+ * The collection must be random access or an indexed lazy collection.
+ * try_foldl returns the fold of the chunks that ran when the policy is
+ * cancelled. foldl has no way to report a partial fold and throws Error
+ * when given a cancellable policy.
+ */
+template <typename V, typename F, typename Arr>
+[[nodiscard]]
+auto try_foldl(ParallelPolicy const& policy, F f, const V init, Arr const& arr) -> Partial<V> {
+    static_assert(detail::is_indexed_v<Arr>,
+                  "parallel f::foldl requires a random access or indexed collection");
+    const auto plan = detail::plan_chunks(policy, detail::size_hint(arr), detail::chunk_align_v<Arr>);
+    std::vector<V> partial(plan.chunks, init);
+    std::vector<size_t> processed(plan.chunks, 0);
+    const Status status = detail::parallel_chunks(policy, plan, [&](size_t c, size_t b, size_t e) {
+        V acc = init;
+        for (size_t i = b; i < e; i++)
+            acc = f(std::move(acc), detail::element(arr, i));
+        partial[c] = std::move(acc);
+        processed[c] = e - b;
+    });
+    Partial<V> out{init, status, 0};
+    for (size_t c = 0; c < plan.chunks; c++) {
+        out.value = f(std::move(out.value), std::move(partial[c]));
+        out.processed += processed[c];
+    }
+    return out;
+}
+
+template <typename V, typename F, typename Arr>
+[[nodiscard]]
+auto foldl(ParallelPolicy const& policy, F f, const V init, Arr const& arr) -> V {
+    detail::check_uncancellable(policy, "f::foldl");
+    return try_foldl(policy, std::move(f), init, arr).value;
+}
+
+/* F([A]) -> [B]
+ *
+ * Parallel fmap, the collection is transformed in parallel chunks directly
+ * into the output collection B, std::vector by default.
+ * The collection must be random access or an indexed lazy collection, and B
+ * must be random access with resize().
+ * try_fmap leaves the elements of the chunks skipped by a cancelled policy
+ * value-initialized. fmap has no way to report a partial collection and
+ * throws Error when given a cancellable policy.
+ */
+template <typename B = void, typename F, typename C>
+[[nodiscard]]
+auto try_fmap(ParallelPolicy const& policy, F&& f, C const& in) {
+    static_assert(detail::is_indexed_v<C>,
+                  "parallel f::fmap requires a random access or indexed collection");
+    using R = std::remove_cvref_t<decltype(std::invoke(f, detail::element(in, 0)))>;
+    using Out = std::conditional_t<std::is_void_v<B>, std::vector<R>, B>;
+    const size_t n = detail::size_hint(in);
+    Partial<Out> out{};
+    out.value.resize(n);
+    std::atomic<size_t> processed{0};
+    const auto plan = detail::plan_chunks(policy, n, detail::cache_line_elements<R>);
+    out.status = detail::parallel_chunks(policy, plan, [&](size_t, size_t b, size_t e) {
+        for (size_t i = b; i < e; i++)
+            out.value[i] = std::invoke(f, detail::element(in, i));
+        processed.fetch_add(e - b, std::memory_order_relaxed);
+    });
+    out.processed = processed.load(std::memory_order_relaxed);
+    return out;
+}
+
+template <typename B = void, typename F, typename C>
+[[nodiscard]]
+auto fmap(ParallelPolicy const& policy, F&& f, C const& in) {
+    detail::check_uncancellable(policy, "f::fmap");
+    return try_fmap<B>(policy, std::forward<F>(f), in).value;
+}
+
+/* scanl(P, F, V, C)
+ *
+ * Parallel scan expression in two passes: every chunk is folded in parallel,
+ * the chunk totals are scanned, and every chunk is then scanned in parallel
+ * from the total of the chunks before it.
+ * F must be associative and V must be an identity of F, e.g. + and 0.
+ * A scan is only meaningful as a whole, so it ignores cancellation.
+ */
+template <typename V, typename F, typename Arr>
+[[nodiscard]]
+auto scanl(ParallelPolicy const& cancellable_policy, F f, const V init, Arr const& arr) -> std::vector<V> {
+    static_assert(detail::is_indexed_v<Arr>,
+                  "parallel f::scanl requires a random access or indexed collection");
+    const ParallelPolicy policy = cancellable_policy.uncancellable();
+    const size_t n = detail::size_hint(arr);
+    std::vector<V> out(n, init);
+    const auto plan = detail::plan_chunks(policy, n, detail::cache_line_elements<V>);
+    std::vector<V> offsets(plan.chunks + 1, init);
+    detail::parallel_chunks(policy, plan, [&](size_t c, size_t b, size_t e) {
+        V acc = init;
+        for (size_t i = b; i < e; i++)
+            acc = f(std::move(acc), detail::element(arr, i));
+        offsets[c + 1] = std::move(acc);
+    });
+    for (size_t c = 1; c <= plan.chunks; c++)
+        offsets[c] = f(offsets[c - 1], offsets[c]);
+    detail::parallel_chunks(policy, plan, [&](size_t c, size_t b, size_t e) {
+        V acc = offsets[c];
+        for (size_t i = b; i < e; i++) {
+            acc = f(std::move(acc), detail::element(arr, i));
+            out[i] = acc;
+        }
+    });
+    return out;
+}
+
+}
+
+
+namespace fp {
+
+/**
+ * @brief Configuration of an AsyncPipe stage boundary.
+ * The ring buffer holds 'capacity' elements, which are the credits of the
+ * producing thread: once they are used up the producer waits for the consumer
+ * to return them, bounding the memory held by a slow sink.
+ * Batches start at 'min_batch' elements and adapt between 'min_batch' and
+ * 'max_batch': they grow whenever the producer runs out of credits, and
+ * shrink whenever the consumer is idle, in which case the partial batch is
+ * handed over at once, trading throughput under load for latency when idle.
+ * Equal batch limits give a fixed batch size.
+ */
+struct AsyncConfig {
+    size_t capacity = 1024;  ///< ring buffer capacity in elements
+    size_t min_batch = 1;    ///< smallest batch moved at a time
+    size_t max_batch = 256;  ///< largest batch moved at a time
+};
+
+/**
+ * @brief Gauge of an AsyncPipe stage boundary.
+ * Updated by the stage while it runs and readable from any thread.
+ */
+struct AsyncGauge {
+    std::atomic<size_t> depth{0};      ///< elements queued in the ring buffer
+    std::atomic<size_t> max_depth{0};  ///< largest observed queue depth
+    std::atomic<size_t> batch{0};      ///< current batch size
+    std::atomic<size_t> stalls{0};     ///< times the producer ran out of credits
+};
+
+/* A -> A
+ *
+ * 'AsyncPipe' is a stage boundary, the stages after it run on a separate
+ * thread.
+ * Elements are collected in batches on the producing thread and handed to the
+ * consuming thread through a bounded lock-free SPSC ring buffer. The consuming
+ * thread is started by the first element and joined when the pipeline is
+ * finished, so a pipeline of several boundaries runs every segment on its own
+ * core.
+ * The ring buffer applies backpressure and the batch size adapts to the load,
+ * see AsyncConfig. The stage is observed through its gauge().
+ */
+template <typename T>
+class AsyncPipe {
+public:
+    using category = detail::pipe_tag;
+    using value_type = T;
+
+    explicit AsyncPipe(AsyncConfig config = {})
+        : m_config(sanitize(config)),
+          m_gauge(std::make_shared<AsyncGauge>()),
+          m_batch(m_config.min_batch) {
+        m_gauge->batch.store(m_batch, std::memory_order_relaxed);
+    }
+
+    /**@brief Copy of the stage configuration, sharing the gauge of other*/
+    AsyncPipe(const AsyncPipe& other)
+        : m_config(other.m_config), m_gauge(other.m_gauge), m_batch(m_config.min_batch) {}
+    AsyncPipe(AsyncPipe&& other) noexcept = default;
+
+    ~AsyncPipe(void) {
+        if (m_state && m_state->worker.joinable())
+            stop();
+    }
+
+    /**
+     * @brief Gauge of this stage, shared with the running stage.
+     * Copies of a stage, such as an lvalue stage composed into a pipeline,
+     * share its gauge, which then reflects the copy that runs.
+     */
+    std::shared_ptr<const AsyncGauge> gauge(void) const { return m_gauge; }
+
+    template <typename U, typename Next>
+    void push(U&& v, Next& next) {
+        if (!m_state || !m_state->worker.joinable())
+            start(next);
+        auto& pending = m_state->pending;
+        pending.push_back(std::forward<U>(v));
+        if (pending.size() >= m_batch)
+            flush();
+        else if (m_state->waiting.load(std::memory_order_relaxed)) {
+            // The consumer is starving, hand over what we have and favor latency.
+            m_state->waiting.store(false, std::memory_order_relaxed);
+            flush();
+            resize_batch(m_batch / 2);
+        }
+    }
+
+    template <typename Next>
+    void finish(Next& next) {
+        if (m_state && m_state->worker.joinable())
+            stop();
+        detail::finish(next);
+    }
+
+private:
+    struct State {
+        explicit State(size_t capacity) : ring(capacity) {}
+        f::SpscRing<T> ring;
+        std::vector<T> pending;
+        std::atomic<bool> done{false};
+        /* Set by the consumer when it finds the ring empty, cleared by the
+         * producer when it hands over a partial batch. On its own cache line
+         * as the producer reads it on every element.
+         */
+        alignas(f::detail::cache_line_size) std::atomic<bool> waiting{false};
+        std::thread worker;
+    };
+
+    static AsyncConfig sanitize(AsyncConfig config) {
+        config.min_batch = std::max<size_t>(config.min_batch, 1);
+        config.max_batch = std::max(config.max_batch, config.min_batch);
+        config.capacity = std::max(config.capacity, config.max_batch);
+        return config;
+    }
+
+    template <typename Next>
+    void start(Next& next) {
+        if (!m_state)
+            m_state = std::make_unique<State>(m_config.capacity);
+        m_state->done.store(false, std::memory_order_relaxed);
+        m_state->waiting.store(false, std::memory_order_relaxed);
+        m_state->pending.reserve(m_config.max_batch);
+        // The sink is copied on this thread, before 'next' can go out of scope.
+        using Held = std::conditional_t<detail::is_reference_sink<Next>::value,
+                                        Next, std::reference_wrapper<Next>>;
+        m_state->worker = std::thread([state = m_state.get(), gauge = m_gauge.get(),
+                                       batch = m_config.max_batch,
+                                       held = Held(next)](void) mutable {
+            Next& sink = held;
+            std::vector<T> items(batch);
+            f::detail::Backoff backoff;
+            for (;;) {
+                const bool done = state->done.load(std::memory_order_acquire);
+                const size_t n = state->ring.pop_batch(items.data(), batch);
+                if (n != 0) {
+                    gauge->depth.store(state->ring.size(), std::memory_order_relaxed);
+                    backoff.reset();
+                }
+                for (size_t i = 0; i < n; i++)
+                    sink.push(std::move(items[i]));
+                if (n == 0) {
+                    if (done)
+                        return;
+                    if (!state->waiting.load(std::memory_order_relaxed))
+                        state->waiting.store(true, std::memory_order_relaxed);
+                    backoff.wait();
+                }
+            }
+        });
+    }
+
+    void stop(void) {
+        flush();
+        m_state->done.store(true, std::memory_order_release);
+        m_state->worker.join();
+        m_gauge->depth.store(0, std::memory_order_relaxed);
+    }
+
+    void flush(void) {
+        auto& pending = m_state->pending;
+        auto& ring = m_state->ring;
+        f::detail::Backoff backoff;
+        bool stalled = false;
+        size_t sent = 0;
+        while (sent < pending.size()) {
+            const size_t n = ring.push_batch(pending.data() + sent, pending.size() - sent);
+            if (n == 0) {
+                stalled = true;
+                backoff.wait();
+            }
+            sent += n;
+        }
+        pending.clear();
+
+        const size_t depth = ring.size();
+        m_gauge->depth.store(depth, std::memory_order_relaxed);
+        if (depth > m_gauge->max_depth.load(std::memory_order_relaxed))
+            m_gauge->max_depth.store(depth, std::memory_order_relaxed);
+        if (stalled) {
+            // Out of credits, the consumer is the bottleneck: favor throughput.
+            m_gauge->stalls.fetch_add(1, std::memory_order_relaxed);
+            resize_batch(m_batch * 2);
+        }
+    }
+
+    void resize_batch(size_t batch) {
+        m_batch = std::clamp(batch, m_config.min_batch, m_config.max_batch);
+        m_gauge->batch.store(m_batch, std::memory_order_relaxed);
+    }
+
+    AsyncConfig m_config;                  ///< ring and batch limits
+    std::shared_ptr<AsyncGauge> m_gauge;   ///< shared with observers
+    size_t m_batch;                        ///< current batch size
+    std::unique_ptr<State> m_state;        ///< created on first push
+};
+
+template <typename T>
+auto async(AsyncConfig config = {}) {
+    return AsyncPipe<T>(config);
+}
+
+template <typename T>
+auto async(size_t capacity, size_t batch) {
+    return AsyncPipe<T>(AsyncConfig{capacity, batch, batch});
+}
+
+}
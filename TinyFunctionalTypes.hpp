@@ -1,8 +1,16 @@
 #pragma once
 
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
 #include <string>
 #include <functional>
+#include <limits>
+#include <memory>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace f {
 
@@ -24,6 +32,16 @@ private:
 
 class BadAccess : Error {};
 
+namespace detail {
+
+/* The throw is kept out of line so accessors stay small enough to inline.
+ */
+[[noreturn]] inline void throw_bad_access(void) {
+    throw BadAccess();
+}
+
+}
+
 /* nullvalue_t is a tag to have compile-time invalid types.
  * nullvalue_t defines an explicit constructor to ensure that automatic
  * template deduction does not interpret {} as a nullvalue_t when used
@@ -37,6 +55,125 @@ struct nullvalue_t {
  */
 constexpr nullvalue_t nullvalue{0};
 
+/**
+ * @brief Access policies of the checked accessors, such as
+ * Optional::get_value, on an invalid access:
+ * 'checked' throws BadAccess, 'assert_only' asserts in debug builds and
+ * assumes valid access in release builds, 'unchecked' assumes valid access.
+ * Assuming valid access lets the accessors inline without exception
+ * machinery, and makes an invalid access undefined behaviour.
+ */
+struct checked {};
+struct assert_only {};
+struct unchecked {};
+
+/* The library-wide access policy is 'checked', define
+ * TINYFUNCTIONAL_ACCESS_POLICY as another policy to change it.
+ */
+#ifndef TINYFUNCTIONAL_ACCESS_POLICY
+#define TINYFUNCTIONAL_ACCESS_POLICY ::f::checked
+#endif
+using default_access_policy = TINYFUNCTIONAL_ACCESS_POLICY;
+
+/**
+ * @brief Access policy of type C, specialize to change it per type.
+ */
+template <class C>
+struct access_policy { using type = default_access_policy; };
+
+template <class C>
+using access_policy_t = typename access_policy<C>::type;
+
+template <class P>
+constexpr bool is_checked_v = std::is_same_v<P, checked>;
+
+namespace detail {
+
+[[noreturn]] inline void unreachable(void) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_unreachable();
+#elif defined(_MSC_VER)
+    __assume(false);
+#endif
+}
+
+/* Handle the validity of an access under the access policy P.
+ */
+template <class P>
+constexpr void check_access(bool valid) noexcept(!is_checked_v<P>) {
+    static_assert(std::is_same_v<P, checked> || std::is_same_v<P, assert_only>
+                  || std::is_same_v<P, unchecked>, "unknown f access policy");
+    if (valid)
+        return;
+    if constexpr (is_checked_v<P>)
+        throw_bad_access();
+    else {
+        if constexpr (std::is_same_v<P, assert_only>)
+            assert(valid && "f: invalid access");
+        unreachable();
+    }
+}
+
+}
+
+/* in_place_t is a tag selecting the constructors that construct the value
+ * in place from the given arguments.
+ */
+struct in_place_t {
+    explicit in_place_t(void) = default;
+};
+inline constexpr in_place_t in_place{};
+
+namespace detail {
+
+/* Operations shared by the Storage specializations.
+ * The Storage union is constructed and destroyed through these, so the
+ * specializations only differ in which special members are trivial.
+ */
+template <class S>
+struct storage_ops {
+    /**@brief Construct the value in place, the storage must be disengaged*/
+    template <class... Args>
+    constexpr void construct(Args&&... args) {
+        S& self = static_cast<S&>(*this);
+        std::construct_at(std::addressof(self.value), std::forward<Args>(args)...);
+        self.engaged = true;
+    }
+    /**@brief Assign the value, constructing it if disengaged*/
+    template <class U>
+    constexpr void assign(U&& v) {
+        S& self = static_cast<S&>(*this);
+        if (self.engaged)
+            self.value = std::forward<U>(v);
+        else
+            construct(std::forward<U>(v));
+    }
+    /**@brief Destroy the value if engaged*/
+    constexpr void reset(void) noexcept {
+        S& self = static_cast<S&>(*this);
+        if (self.engaged)
+            std::destroy_at(std::addressof(self.value));
+        self.engaged = false;
+    }
+    /**@brief Check if the storage is engaged*/
+    constexpr bool has_value(void) const noexcept {
+        return static_cast<const S&>(*this).engaged;
+    }
+    /**@brief Copy or move the state of another storage*/
+    template <class O>
+    constexpr void assign_from(O&& other) {
+        if (other.engaged)
+            assign(std::forward<O>(other).value);
+        else
+            reset();
+    }
+};
+
+template <class T, class U>
+constexpr bool is_storage_argument_v = !std::is_base_of_v<storage_ops<T>, std::remove_cvref_t<U>>;
+
+}
+
 /**
  * @brief Storage of a single value.
  * This storage template is instansiated for non-trivial types and enforces
@@ -45,56 +182,227 @@ constexpr nullvalue_t nullvalue{0};
  * @see class Storage
  */
 template <class T, class E = void>
-struct Storage {
+struct Storage : detail::storage_ops<Storage<T, E>> {
     union { nullvalue_t null; T value; }; ///< Internal storage space
     bool engaged = false;                 ///< Engaged signature
 
     /**@brief Non-Trivial Destructor*/
-    ~Storage(void) {
-        if (engaged) value.T::~T();
-        engaged = false;
-    }
+    constexpr ~Storage(void) { this->reset(); }
     /**@brief Disengaged Constructor*/
     constexpr Storage(void) noexcept {};
     /**@brief Engaged Constructor*/
     template <class U>
+    requires detail::is_storage_argument_v<Storage, U>
     constexpr Storage(const U& v) noexcept : value(v), engaged(true) {};
     /**@brief Engaged Constructor*/
     template <class U>
-    constexpr Storage(U &&v) noexcept : value(v), engaged(true) {};
+    requires detail::is_storage_argument_v<Storage, U>
+    constexpr Storage(U &&v) noexcept : value(std::forward<U>(v)), engaged(true) {};
+    /**@brief In-place Constructor*/
+    template <class... Args>
+    constexpr explicit Storage(in_place_t, Args&&... args)
+        : value(std::forward<Args>(args)...), engaged(true) {};
+    /**@brief Copy Constructor*/
+    constexpr Storage(const Storage& other) {
+        if (other.engaged) this->construct(other.value);
+    }
+    /**@brief Move Constructor*/
+    constexpr Storage(Storage&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        if (other.engaged) this->construct(std::move(other.value));
+    }
+    /**@brief Copy Assignment*/
+    constexpr Storage& operator=(const Storage& other) {
+        this->assign_from(other);
+        return *this;
+    }
+    /**@brief Move Assignment*/
+    constexpr Storage& operator=(Storage&& other) noexcept(std::is_nothrow_move_assignable_v<T>
+                                                           && std::is_nothrow_move_constructible_v<T>) {
+        this->assign_from(std::move(other));
+        return *this;
+    }
 };
 
 /**
  * @brief Storage of a single value.
- * This storage template is instansiated for trivial types and omits explicit
- * destruction.
+ * This storage template is instansiated for trivially destructible types and
+ * omits explicit destruction. Copy and move are trivial whenever they are
+ * for T, so trivially copyable types give a trivially copyable Storage.
  * Storage can be seen as a vector of size 1.
  * @see class Storage
  */
 template <class T>
-struct Storage<T, std::enable_if_t<std::is_trivially_destructible_v<T>>> {
+struct Storage<T, std::enable_if_t<std::is_trivially_destructible_v<T>>>
+    : detail::storage_ops<Storage<T>> {
     union { nullvalue_t null; T value; }; ///< Internal storage space
     bool engaged = false;                 ///< Engaged signature
 
     /**@brief Trivial Destructor*/
-    ~Storage(void) {engaged = false;};
+    ~Storage(void) = default;
     /**@brief Disengaged Constructor*/
     constexpr Storage(void) noexcept {};
     /**@brief Engaged Constructor*/
     template <class U>
+    requires detail::is_storage_argument_v<Storage, U>
     constexpr Storage(const U& v) noexcept : value(v), engaged(true) {};
     /**@brief Engaged Constructor*/
     template <class U>
-    constexpr Storage(U &&v) noexcept : value(v), engaged(true) {};
+    requires detail::is_storage_argument_v<Storage, U>
+    constexpr Storage(U &&v) noexcept : value(std::forward<U>(v)), engaged(true) {};
+    /**@brief In-place Constructor*/
+    template <class... Args>
+    constexpr explicit Storage(in_place_t, Args&&... args)
+        : value(std::forward<Args>(args)...), engaged(true) {};
+
+    /**@brief Trivial Copy Constructor*/
+    Storage(const Storage&) requires std::is_trivially_copy_constructible_v<T> = default;
+    /**@brief Copy Constructor*/
+    constexpr Storage(const Storage& other) {
+        if (other.engaged) this->construct(other.value);
+    }
+    /**@brief Trivial Move Constructor*/
+    Storage(Storage&&) requires std::is_trivially_move_constructible_v<T> = default;
+    /**@brief Move Constructor*/
+    constexpr Storage(Storage&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        if (other.engaged) this->construct(std::move(other.value));
+    }
+    /**@brief Trivial Copy Assignment*/
+    Storage& operator=(const Storage&) requires (std::is_trivially_copy_assignable_v<T>
+                                                 && std::is_trivially_copy_constructible_v<T>) = default;
+    /**@brief Copy Assignment*/
+    constexpr Storage& operator=(const Storage& other) {
+        this->assign_from(other);
+        return *this;
+    }
+    /**@brief Trivial Move Assignment*/
+    Storage& operator=(Storage&&) requires (std::is_trivially_move_assignable_v<T>
+                                            && std::is_trivially_move_constructible_v<T>) = default;
+    /**@brief Move Assignment*/
+    constexpr Storage& operator=(Storage&& other) noexcept(std::is_nothrow_move_assignable_v<T>
+                                                           && std::is_nothrow_move_constructible_v<T>) {
+        this->assign_from(std::move(other));
+        return *this;
+    }
+};
+
+/**
+ * @brief Niche policy using the value V of T as the disengaged state.
+ * Optional<int, sentinel<-1>> is disengaged exactly when it holds -1.
+ */
+template <auto V>
+struct sentinel {
+    template <class T>
+    static constexpr T null_value(void) noexcept { return static_cast<T>(V); }
+    template <class T>
+    static constexpr bool is_null(const T& v) noexcept { return v == static_cast<T>(V); }
 };
 
+/**
+ * @brief Niche policy using NaN as the disengaged state of floating point
+ * types, so engaged values are never NaN.
+ */
+struct nan_niche {
+    template <class T>
+    static constexpr T null_value(void) noexcept { return std::numeric_limits<T>::quiet_NaN(); }
+    template <class T>
+    static constexpr bool is_null(const T& v) noexcept { return v != v; }
+};
 
-template <typename T>
+/**
+ * @brief Niche policy using nullptr as the disengaged state of pointers.
+ */
+struct null_pointer {
+    template <class T>
+    static constexpr T null_value(void) noexcept { return nullptr; }
+    template <class T>
+    static constexpr bool is_null(const T& v) noexcept { return v == nullptr; }
+};
+
+/**
+ * @brief Default niche policy of T, void when T has no niche.
+ * Specialize to give a type a niche, e.g. an unused enum value.
+ */
+template <class T, class = void>
+struct niche_traits { using type = void; };
+
+template <class T>
+struct niche_traits<T, std::enable_if_t<std::is_floating_point_v<T>>> { using type = nan_niche; };
+
+template <class T>
+struct niche_traits<T, std::enable_if_t<std::is_pointer_v<T>>> { using type = null_pointer; };
+
+/**
+ * @brief Storage of a single value encoding the disengaged state in the
+ * value itself through the niche policy N, so it is the size of T.
+ * The value is always alive and holds the null value of N when disengaged.
+ * @see class Storage
+ */
+template <class T, class N>
+struct NicheStorage {
+    T value = N::template null_value<T>(); ///< Internal storage space
+
+    /**@brief Disengaged Constructor*/
+    constexpr NicheStorage(void) noexcept = default;
+    /**@brief Engaged Constructor, disengaged for the null value*/
+    template <class U>
+    requires (!std::is_same_v<std::remove_cvref_t<U>, NicheStorage>)
+    constexpr NicheStorage(U&& v) : value(std::forward<U>(v)) {}
+    /**@brief In-place Constructor*/
+    template <class... Args>
+    constexpr explicit NicheStorage(in_place_t, Args&&... args) : value(std::forward<Args>(args)...) {}
+
+    constexpr bool has_value(void) const noexcept { return !N::is_null(value); }
+
+    template <class... Args>
+    constexpr void construct(Args&&... args) { value = T(std::forward<Args>(args)...); }
+    template <class U>
+    constexpr void assign(U&& v) { value = std::forward<U>(v); }
+    constexpr void reset(void) noexcept { value = N::template null_value<T>(); }
+};
+
+template <typename T, typename N = void>
+class Optional;
+
+namespace detail {
+
+template <class>
+struct is_optional : std::false_type {};
+
+template <class T, class N>
+struct is_optional<Optional<T, N>> : std::true_type {};
+
+template <class U>
+constexpr bool is_optional_v = is_optional<std::remove_cvref_t<U>>::value;
+
+/* Access to the storage of an Optional, for bulk algorithms reading it
+ * without branching on engagement.
+ */
+struct optional_access {
+    template <class O>
+    static constexpr auto const& storage(O const& o) noexcept { return o.m_storage; }
+};
+
+}
+
+/**
+ * @brief Optional value of type T.
+ * Optional is trivially copyable and destructible whenever T is, so
+ * Optional of a trivial type is passed and returned in registers.
+ * Given a niche policy N, the disengaged state is a value of T and the
+ * Optional is the size of T, e.g. Optional<double, nan_niche>.
+ * @see class Storage
+ * @see class NicheStorage
+ */
+template <typename T, typename N>
 class Optional {
 public:
     using value_type = T;
+    using niche_type = N;
+    using access = access_policy_t<Optional>;
     using value_reference = T&;
     using rvalue_reference = T&&;
+    using const_value_reference = const T&;
+    using const_rvalue_reference = const T&&;
 
     static_assert(!std::is_reference_v<value_type>,
                   "Creating f::Optional of a reference type is ill-formed");
@@ -110,6 +418,18 @@ public:
      */
     ~Optional(void) noexcept = default;
 
+    /**
+     * @brief Copy and Move Constructors and Assignments.
+     *
+     * Maybe-trivial due to the chosen overloaded members of Storage.
+     *
+     * @see class Storage
+     */
+    constexpr Optional(const Optional&) = default;
+    constexpr Optional(Optional&&) = default;
+    constexpr Optional& operator=(const Optional&) = default;
+    constexpr Optional& operator=(Optional&&) = default;
+
     /**
      * @brief Default Constructor.
      *
@@ -124,7 +444,7 @@ public:
      * explicit nullvalue as input.
      * @see nullvalue_t
      */
-    explicit constexpr Optional(nullvalue_t) noexcept {};
+    constexpr Optional(nullvalue_t) noexcept {};
 
     /**
      * @brief Engaged Constructor.
@@ -136,6 +456,7 @@ public:
     //template <class U, std::enable_if<std::is_convertible_v<std::decay_t<U>, T>>>
     //template <class U, std::enable_if<std::is_copy_constructible_v<U>>>
     template<class U>
+    requires (!detail::is_optional_v<U> && std::is_constructible_v<T, U&&>)
     constexpr Optional(U&& u) : m_storage(std::forward<U>(u)) {}
 
     /**
@@ -148,8 +469,20 @@ public:
     //template <class U, std::enable_if<std::is_convertible_v<std::decay_t<U>, T>>>
     //template <class U, std::enable_if<std::is_copy_constructible_v<U>>>
     template <class U>
+    requires (!detail::is_optional_v<U> && std::is_constructible_v<T, const U&>)
     constexpr Optional(const U& v) : Optional(std::move(v)) {}
 
+    /**
+     * @brief In-place Constructor.
+     *
+     * @param args the arguments to construct the value from
+     * Constructor that creates an optional containing the value T(args...),
+     * constructed directly in the storage.
+     */
+    template <class... Args>
+    constexpr explicit Optional(in_place_t, Args&&... args)
+        : m_storage(in_place, std::forward<Args>(args)...) {}
+
     /**
      * @brief Engaged Constructor.
      *
@@ -159,10 +492,10 @@ public:
      */
     //template <class U, std::enable_if<std::is_copy_constructible_v<U>
     //                                  && std::is_convertible_v<std::decay_t<U>, T>>>
-    template <class U>
-    constexpr Optional(const Optional<U>& opt) {
-        reset();
-        *this = opt.get_value();
+    template <class U, class M>
+    constexpr Optional(const Optional<U, M>& opt) {
+        if (opt.has_value())
+            m_storage.assign(opt.get_value());
     }
 
     /**
@@ -174,25 +507,22 @@ public:
      */
     //template <class U, std::enable_if<std::is_copy_constructible_v<U>
     //                                  && std::is_convertible_v<std::decay_t<U>, T>>>
-    template <class U>
-    constexpr Optional(Optional<U>&& opt) {
-        reset();
-        *this = opt.get_value();
+    template <class U, class M>
+    constexpr Optional(Optional<U, M>&& opt) {
+        if (opt.has_value())
+            m_storage.assign(std::move(opt).get_value());
     }
 
     /**
      * @brief Engaged Assignment Operator.
      *
-     * @param rhs the lvalue to assign from as an lvalue reference
-     * Copying operator that creates an optional containing rhs.
+     * @param rhs the rvalue to assign from as an rvalue reference
+     * Moving operator that creates an optional containing rhs.
      * @todo implement some sort of SFINAE template rules
      * @todo use U templating like above
-     * @todo implement assignment to class Storage directly instead
      */
     constexpr void operator=(T&& rhs) {
-        reset();
-        m_storage.value = rhs;
-        m_storage.engaged = true;
+        m_storage.assign(std::move(rhs));
     }
 
     /**
@@ -202,12 +532,24 @@ public:
      * Copying operator that creates an optional containing a copy of rhs.
      * @todo implement some sort of SFINAE template rules
      * @todo use U templating like above
-     * @todo implement assignment to class Storage directly instead
      */
     constexpr void operator=(const T& rhs) {
+        m_storage.assign(rhs);
+    }
+
+    /**
+     * @brief Engage in place.
+     *
+     * @param args the arguments to construct the value from
+     * Destroys the contained value if any, and constructs T(args...)
+     * directly in the storage.
+     * @return reference to the new value
+     */
+    template <class... Args>
+    constexpr value_reference emplace(Args&&... args) {
         reset();
-        m_storage.value = rhs;
-        m_storage.engaged = true;
+        m_storage.construct(std::forward<Args>(args)...);
+        return m_storage.value;
     }
 
     /**
@@ -217,11 +559,12 @@ public:
      * Copying operator that creates an optional containing a copy of the optional rhs.
      * @todo implement some sort of SFINAE template rules
      */
-    template <class U>
-    constexpr void operator=(const Optional<U>& rhs) {
-        reset();
+    template <class U, class M>
+    constexpr void operator=(const Optional<U, M>& rhs) {
         if (rhs.has_value())
-            m_storage = std::move(rhs.get_value());
+            m_storage.assign(rhs.get_value());
+        else
+            reset();
     }
 
     /**
@@ -233,11 +576,12 @@ public:
      */
     //template <class U, std::enable_if<std::is_copy_assignable_v<U>
     //                                  && std::is_convertible_v<std::decay_t<U>, T>>>
-    template <class U>
-    constexpr void operator=(Optional<U>&& rhs) {
-        reset();
+    template <class U, class M>
+    constexpr void operator=(Optional<U, M>&& rhs) {
         if (rhs.has_value())
-            m_storage = std::move(rhs.get_value());
+            m_storage.assign(std::move(rhs).get_value());
+        else
+            reset();
     }
 
     /**
@@ -259,7 +603,7 @@ public:
      * @see class Storage
      */
     constexpr void reset(void) {
-        m_storage.~Storage();
+        m_storage.reset();
     }
 
     /**
@@ -267,7 +611,7 @@ public:
      * @see class Storage
      */
     constexpr bool has_value(void) const noexcept {
-        return m_storage.engaged;
+        return m_storage.has_value();
     }
 
     /**
@@ -281,43 +625,43 @@ public:
 
     /**
      * @brief  Maybe-throwing accessor.
-     * @throw BadAccess if optional is disengaged
+     * @throw BadAccess if optional is disengaged, under the checked access policy
      * @see class BadAccess
      */
-    constexpr value_reference get_value(void) & {
-        if (!has_value()) throw BadAccess();
+    constexpr value_reference get_value(void) & noexcept(!is_checked_v<access>) {
+        detail::check_access<access>(has_value());
         return m_storage.value;
     }
 
     /**
      * @brief  Maybe-throwing accessor.
      * Leaves optional value in undefined post-move state and does not reset()
-     * @throw BadAccess if optional is disengaged
+     * @throw BadAccess if optional is disengaged, under the checked access policy
      * @see class BadAccess
      */
-    constexpr rvalue_reference get_value(void) && {
-        if (!has_value()) throw BadAccess();
+    constexpr rvalue_reference get_value(void) && noexcept(!is_checked_v<access>) {
+        detail::check_access<access>(has_value());
         return std::move(m_storage.value);
     }
 
     /**
      * @brief  Maybe-throwing accessor.
-     * @throw BadAccess if optional is disengaged
+     * @throw BadAccess if optional is disengaged, under the checked access policy
      * @see class BadAccess
      */
-    constexpr value_reference get_value(void) const& {
-        if (!has_value()) throw BadAccess();
+    constexpr const_value_reference get_value(void) const& noexcept(!is_checked_v<access>) {
+        detail::check_access<access>(has_value());
         return m_storage.value;
     }
 
     /**
      * @brief  Maybe-throwing accessor.
      * Leaves optional value in undefined post-move state and does not reset()
-     * @throw BadAccess if optional is disengaged
+     * @throw BadAccess if optional is disengaged, under the checked access policy
      * @see class BadAccess
      */
-    constexpr rvalue_reference get_value(void) const&& {
-        if (!has_value()) throw BadAccess();
+    constexpr const_rvalue_reference get_value(void) const&& noexcept(!is_checked_v<access>) {
+        detail::check_access<access>(has_value());
         return std::move(m_storage.value);
     }
 
@@ -339,7 +683,7 @@ public:
     /**
      * @brief  Non-throwing accessor.
      */
-    constexpr value_reference operator*(void) const& noexcept {
+    constexpr const_value_reference operator*(void) const& noexcept {
         return m_storage.value;
     }
 
@@ -347,15 +691,22 @@ public:
      * @brief  Non-throwing accessor.
      * Leaves optional value in undefined post-move state and does not reset()
      */
-    constexpr rvalue_reference operator*(void) const&& noexcept {
+    constexpr const_rvalue_reference operator*(void) const&& noexcept {
         return std::move(m_storage.value);
     }
 
     /**
-     * @brief  Non-throwing accessor.
+     * @brief  Non-throwing member accessor.
      */
-    constexpr value_reference operator->(void) noexcept {
-        return m_storage.value;
+    constexpr T* operator->(void) noexcept {
+        return std::addressof(m_storage.value);
+    }
+
+    /**
+     * @brief  Non-throwing member accessor.
+     */
+    constexpr const T* operator->(void) const noexcept {
+        return std::addressof(m_storage.value);
     }
 
     template <class F>
@@ -392,6 +743,31 @@ public:
         return bool(*this) ? std::move(*this) : std::forward<F>(f)();
     }
 
+    /**@brief Map the value with f into an Optional of the result*/
+    template <class F>
+    constexpr auto transform(F&& f) const& {
+        using R = Optional<std::remove_cvref_t<std::invoke_result_t<F, const T&>>>;
+        return bool(*this) ? R(in_place, std::invoke(std::forward<F>(f), **this)) : R();
+    }
+
+    template <class F>
+    constexpr auto transform(F&& f) && {
+        using R = Optional<std::remove_cvref_t<std::invoke_result_t<F, T&&>>>;
+        return bool(*this) ? R(in_place, std::invoke(std::forward<F>(f), std::move(**this))) : R();
+    }
+
+    /**@brief Keep the value if it satisfies p, disengage otherwise*/
+    template <class P>
+    constexpr Optional filter(P&& p) const& {
+        return bool(*this) && std::invoke(std::forward<P>(p), **this) ? *this : Optional();
+    }
+
+    template <class P>
+    constexpr Optional filter(P&& p) && {
+        return bool(*this) && std::invoke(std::forward<P>(p), std::as_const(**this))
+            ? std::move(*this) : Optional();
+    }
+
     template <class U>
     constexpr T get_value_or( U&& other) const& {
         return bool(*this) ? m_storage.value : static_cast<T>(std::forward<U>(other));
@@ -404,20 +780,638 @@ public:
 
 
 private:
-    Storage<T> m_storage; ///< maybe-trivial destructor invocated storage
+    friend struct detail::optional_access;
+    using storage_type = std::conditional_t<std::is_void_v<N>, Storage<T>, NicheStorage<T, N>>;
+    storage_type m_storage; ///< maybe-trivial destructor invocated storage
+};
+
+/**
+ * @brief Optional reference to a T.
+ * Stores a pointer with nullptr as the disengaged state, so it is the size
+ * of a pointer and trivially copyable. Assignment of a T& rebinds the
+ * reference rather than assigning through it, and temporaries are refused.
+ */
+template <typename T, typename N>
+class Optional<T&, N> {
+public:
+    using value_type = T&;
+    using niche_type = null_pointer;
+    using access = access_policy_t<Optional>;
+    using value_reference = T&;
+
+    /**@brief Default Constructor, creates an empty optional*/
+    explicit constexpr Optional(void) noexcept {};
+    /**@brief Disengaged Constructor*/
+    constexpr Optional(nullvalue_t) noexcept {};
+    /**@brief Engaged Constructor, referring to ref*/
+    constexpr Optional(T& ref) noexcept : m_ptr(std::addressof(ref)) {}
+    /**@brief Temporaries cannot be referred to*/
+    Optional(T&&) = delete;
+    /**@brief Converting Constructor from an optional reference to a derived or less const type*/
+    template <class U, class M>
+    requires std::is_convertible_v<U*, T*>
+    constexpr Optional(const Optional<U&, M>& opt) noexcept
+        : m_ptr(opt.has_value() ? std::addressof(*opt) : nullptr) {}
+
+    constexpr Optional(const Optional&) noexcept = default;
+    constexpr Optional& operator=(const Optional&) noexcept = default;
+
+    /**@brief Rebind to ref*/
+    constexpr Optional& operator=(T& ref) noexcept {
+        m_ptr = std::addressof(ref);
+        return *this;
+    }
+    Optional& operator=(T&&) = delete;
+
+    /**@brief Disengage*/
+    constexpr void operator=(nullvalue_t) noexcept { reset(); }
+
+    /**@brief Rebind to ref, returning the reference*/
+    constexpr value_reference emplace(T& ref) noexcept {
+        m_ptr = std::addressof(ref);
+        return *m_ptr;
+    }
+
+    constexpr void reset(void) noexcept { m_ptr = nullptr; }
+
+    constexpr bool has_value(void) const noexcept { return m_ptr != nullptr; }
+    constexpr explicit operator bool(void) const noexcept { return has_value(); }
+
+    /**
+     * @brief  Maybe-throwing accessor.
+     * @throw BadAccess if optional is disengaged, under the checked access policy
+     * @see class BadAccess
+     */
+    constexpr value_reference get_value(void) const noexcept(!is_checked_v<access>) {
+        detail::check_access<access>(has_value());
+        return *m_ptr;
+    }
+
+    /**@brief  Non-throwing accessor*/
+    constexpr value_reference operator*(void) const noexcept { return *m_ptr; }
+    /**@brief  Non-throwing member accessor*/
+    constexpr T* operator->(void) const noexcept { return m_ptr; }
+
+    template <class F>
+    constexpr auto and_then(F&& f) const {
+        return bool(*this) ? std::invoke(std::forward<F>(f), *m_ptr)
+                           : std::remove_cvref_t<std::invoke_result_t<F, T&>>{};
+    }
+
+    template <class F>
+    constexpr auto or_else(F&& f) const {
+        return bool(*this) ? *this : Optional(std::forward<F>(f)());
+    }
+
+    template <class F>
+    constexpr auto transform(F&& f) const {
+        using R = Optional<std::remove_cvref_t<std::invoke_result_t<F, T&>>>;
+        return bool(*this) ? R(in_place, std::invoke(std::forward<F>(f), *m_ptr)) : R();
+    }
+
+    template <class P>
+    constexpr Optional filter(P&& p) const {
+        return bool(*this) && std::invoke(std::forward<P>(p), *m_ptr) ? *this : Optional();
+    }
+
+    /**@brief The referred value, or other when disengaged, without copies*/
+    constexpr value_reference get_value_or(T& other) const noexcept {
+        return bool(*this) ? *m_ptr : other;
+    }
+
+    /**@brief A copy of the referred value, or other when disengaged*/
+    template <class U>
+    constexpr std::remove_cv_t<T> get_value_or(U&& other) const {
+        return bool(*this) ? *m_ptr : static_cast<std::remove_cv_t<T>>(std::forward<U>(other));
+    }
+
+private:
+    T* m_ptr = nullptr; ///< referred value, nullptr when disengaged
 };
 
+/**
+ * @brief Optional using the default niche of T when it has one.
+ * @see struct niche_traits
+ */
+template <typename T>
+using CompactOptional = Optional<T, typename niche_traits<T>::type>;
+
 
 /**
- * @brief  Optional creator for non-trivial construction 
+ * @brief  Optional creator for non-trivial construction, the value is
+ * constructed in place without intermediate copies or moves.
  * @see class Optional
  */
 template <typename T, typename... Args>
 constexpr auto make_optional(Args&&... args) {
-    return Optional<T>{T{std::forward<Args>(args)...}};
+    return Optional<T>{in_place, std::forward<Args>(args)...};
 }
     
 
+/* unexpect_t is a tag selecting the constructors of Expected that construct
+ * the error in place from the given arguments.
+ */
+struct unexpect_t {
+    explicit unexpect_t(void) = default;
+};
+inline constexpr unexpect_t unexpect{};
+
+/**
+ * @brief Wrapper marking a value as the error of an Expected.
+ * @see function unexpected
+ */
+template <class E>
+struct Unexpected {
+    E error; ///< the wrapped error
+};
+
+/**
+ * @brief Mark e as the error of an Expected.
+ */
+template <class E>
+constexpr Unexpected<std::decay_t<E>> unexpected(E&& e) {
+    return {std::forward<E>(e)};
+}
+
+namespace detail {
+
+/* Operations shared by the ExpectedStorage specializations, the union is
+ * constructed and destroyed through these like Storage.
+ */
+template <class S>
+struct expected_storage_ops {
+    template <class... Args>
+    constexpr void construct_value(Args&&... args) {
+        S& self = static_cast<S&>(*this);
+        std::construct_at(std::addressof(self.value), std::forward<Args>(args)...);
+        self.engaged = true;
+    }
+    template <class... Args>
+    constexpr void construct_error(Args&&... args) {
+        S& self = static_cast<S&>(*this);
+        std::construct_at(std::addressof(self.error), std::forward<Args>(args)...);
+        self.engaged = false;
+    }
+    constexpr void destroy(void) noexcept {
+        S& self = static_cast<S&>(*this);
+        if (self.engaged)
+            std::destroy_at(std::addressof(self.value));
+        else
+            std::destroy_at(std::addressof(self.error));
+    }
+    template <class O>
+    constexpr void construct_from(O&& other) {
+        if (other.engaged)
+            construct_value(std::forward<O>(other).value);
+        else
+            construct_error(std::forward<O>(other).error);
+    }
+    template <class O>
+    constexpr void assign_from(O&& other) {
+        S& self = static_cast<S&>(*this);
+        if (self.engaged && other.engaged)
+            self.value = std::forward<O>(other).value;
+        else if (!self.engaged && !other.engaged)
+            self.error = std::forward<O>(other).error;
+        else if (other.engaged) {
+            reinit(std::addressof(self.value), std::addressof(self.error), std::forward<O>(other).value);
+            self.engaged = true;
+        }
+        else {
+            reinit(std::addressof(self.error), std::addressof(self.value), std::forward<O>(other).error);
+            self.engaged = false;
+        }
+    }
+    /* Replace the member at prev with one built from arg at next. When the
+     * construction throws the old member is left in place, as the engaged
+     * flag still says.
+     */
+    template <class New, class Old, class Arg>
+    static constexpr void reinit(New* next, Old* prev, Arg&& arg) {
+        if constexpr (std::is_nothrow_constructible_v<New, Arg&&>) {
+            std::destroy_at(prev);
+            std::construct_at(next, std::forward<Arg>(arg));
+        }
+        else if constexpr (std::is_nothrow_move_constructible_v<New>) {
+            New tmp(std::forward<Arg>(arg));
+            std::destroy_at(prev);
+            std::construct_at(next, std::move(tmp));
+        }
+        else {
+            Old tmp(std::move(*prev));
+            std::destroy_at(prev);
+            try {
+                std::construct_at(next, std::forward<Arg>(arg));
+            }
+            catch (...) {
+                std::construct_at(prev, std::move(tmp));
+                throw;
+            }
+        }
+    }
+};
+
+}
+
+/**
+ * @brief Storage of either a value or an error.
+ * This storage template is instansiated for non-trivial types and enforces
+ * explicit destruction of the active member.
+ * @see class Storage
+ */
+template <class T, class E, class = void>
+struct ExpectedStorage : detail::expected_storage_ops<ExpectedStorage<T, E>> {
+    union { T value; E error; }; ///< Internal storage space
+    bool engaged;                ///< Value signature, error when false
+
+    template <class... Args>
+    constexpr explicit ExpectedStorage(in_place_t, Args&&... args)
+        : value(std::forward<Args>(args)...), engaged(true) {}
+    template <class... Args>
+    constexpr explicit ExpectedStorage(unexpect_t, Args&&... args)
+        : error(std::forward<Args>(args)...), engaged(false) {}
+
+    constexpr ~ExpectedStorage(void) { this->destroy(); }
+    constexpr ExpectedStorage(const ExpectedStorage& other) { this->construct_from(other); }
+    constexpr ExpectedStorage(ExpectedStorage&& other) noexcept(std::is_nothrow_move_constructible_v<T>
+                                                                && std::is_nothrow_move_constructible_v<E>) {
+        this->construct_from(std::move(other));
+    }
+    constexpr ExpectedStorage& operator=(const ExpectedStorage& other) {
+        this->assign_from(other);
+        return *this;
+    }
+    constexpr ExpectedStorage& operator=(ExpectedStorage&& other) {
+        this->assign_from(std::move(other));
+        return *this;
+    }
+};
+
+/**
+ * @brief Storage of either a value or an error.
+ * This storage template is instansiated for trivially destructible types and
+ * omits explicit destruction. Copy and move are trivial whenever they are
+ * for both T and E.
+ * @see class Storage
+ */
+template <class T, class E>
+struct ExpectedStorage<T, E, std::enable_if_t<std::is_trivially_destructible_v<T>
+                                              && std::is_trivially_destructible_v<E>>>
+    : detail::expected_storage_ops<ExpectedStorage<T, E>> {
+    union { T value; E error; }; ///< Internal storage space
+    bool engaged;                ///< Value signature, error when false
+
+    template <class... Args>
+    constexpr explicit ExpectedStorage(in_place_t, Args&&... args)
+        : value(std::forward<Args>(args)...), engaged(true) {}
+    template <class... Args>
+    constexpr explicit ExpectedStorage(unexpect_t, Args&&... args)
+        : error(std::forward<Args>(args)...), engaged(false) {}
+
+    ~ExpectedStorage(void) = default;
+
+    ExpectedStorage(const ExpectedStorage&)
+        requires (std::is_trivially_copy_constructible_v<T>
+                  && std::is_trivially_copy_constructible_v<E>) = default;
+    constexpr ExpectedStorage(const ExpectedStorage& other) { this->construct_from(other); }
+    ExpectedStorage(ExpectedStorage&&)
+        requires (std::is_trivially_move_constructible_v<T>
+                  && std::is_trivially_move_constructible_v<E>) = default;
+    constexpr ExpectedStorage(ExpectedStorage&& other) { this->construct_from(std::move(other)); }
+    ExpectedStorage& operator=(const ExpectedStorage&)
+        requires (std::is_trivially_copy_assignable_v<T> && std::is_trivially_copy_constructible_v<T>
+                  && std::is_trivially_copy_assignable_v<E> && std::is_trivially_copy_constructible_v<E>) = default;
+    constexpr ExpectedStorage& operator=(const ExpectedStorage& other) {
+        this->assign_from(other);
+        return *this;
+    }
+    ExpectedStorage& operator=(ExpectedStorage&&)
+        requires (std::is_trivially_move_assignable_v<T> && std::is_trivially_move_constructible_v<T>
+                  && std::is_trivially_move_assignable_v<E> && std::is_trivially_move_constructible_v<E>) = default;
+    constexpr ExpectedStorage& operator=(ExpectedStorage&& other) {
+        this->assign_from(std::move(other));
+        return *this;
+    }
+};
+
+template <typename T, typename E>
+class Expected;
+
+namespace detail {
+
+template <class>
+struct is_expected : std::false_type {};
+
+template <class T, class E>
+struct is_expected<Expected<T, E>> : std::true_type {};
+
+template <class U>
+constexpr bool is_expected_v = is_expected<std::remove_cvref_t<U>>::value;
+
+}
+
+/**
+ * @brief Either a value of type T or an error of type E.
+ * Errors are returned as values instead of thrown, and neither the value
+ * nor the error is allocated. Expected is trivially copyable and
+ * destructible whenever T and E are.
+ * @see class ExpectedStorage
+ */
+template <typename T, typename E>
+class Expected {
+public:
+    using value_type = T;
+    using error_type = E;
+    using access = access_policy_t<Expected>;
+    using value_reference = T&;
+    using const_value_reference = const T&;
+
+    static_assert(!std::is_reference_v<T> && !std::is_reference_v<E>,
+                  "Creating f::Expected of a reference type is ill-formed");
+
+    /**@brief Value Constructor*/
+    template <class U = T>
+    requires (!detail::is_expected_v<U> && !std::is_same_v<std::remove_cvref_t<U>, in_place_t>
+              && !std::is_same_v<std::remove_cvref_t<U>, unexpect_t>
+              && std::is_constructible_v<T, U&&>)
+    constexpr Expected(U&& v) : m_storage(in_place, std::forward<U>(v)) {}
+
+    /**@brief Error Constructor*/
+    template <class G>
+    constexpr Expected(const Unexpected<G>& u) : m_storage(unexpect, u.error) {}
+    template <class G>
+    constexpr Expected(Unexpected<G>&& u) : m_storage(unexpect, std::move(u.error)) {}
+
+    /**@brief In-place Value Constructor*/
+    template <class... Args>
+    constexpr explicit Expected(in_place_t, Args&&... args)
+        : m_storage(in_place, std::forward<Args>(args)...) {}
+    /**@brief In-place Error Constructor*/
+    template <class... Args>
+    constexpr explicit Expected(unexpect_t, Args&&... args)
+        : m_storage(unexpect, std::forward<Args>(args)...) {}
+
+    constexpr Expected(const Expected&) = default;
+    constexpr Expected(Expected&&) = default;
+    constexpr Expected& operator=(const Expected&) = default;
+    constexpr Expected& operator=(Expected&&) = default;
+    ~Expected(void) = default;
+
+    constexpr bool has_value(void) const noexcept { return m_storage.engaged; }
+    constexpr explicit operator bool(void) const noexcept { return has_value(); }
+
+    /**
+     * @brief  Maybe-throwing accessor.
+     * @throw BadAccess if expected holds an error, under the checked access policy
+     * @see class BadAccess
+     */
+    constexpr value_reference get_value(void) & noexcept(!is_checked_v<access>) {
+        detail::check_access<access>(has_value());
+        return m_storage.value;
+    }
+    constexpr const_value_reference get_value(void) const& noexcept(!is_checked_v<access>) {
+        detail::check_access<access>(has_value());
+        return m_storage.value;
+    }
+    constexpr T&& get_value(void) && noexcept(!is_checked_v<access>) {
+        detail::check_access<access>(has_value());
+        return std::move(m_storage.value);
+    }
+
+    /**
+     * @brief  Maybe-throwing error accessor.
+     * @throw BadAccess if expected holds a value, under the checked access policy
+     * @see class BadAccess
+     */
+    constexpr E& get_error(void) & noexcept(!is_checked_v<access>) {
+        detail::check_access<access>(!has_value());
+        return m_storage.error;
+    }
+    constexpr const E& get_error(void) const& noexcept(!is_checked_v<access>) {
+        detail::check_access<access>(!has_value());
+        return m_storage.error;
+    }
+    constexpr E&& get_error(void) && noexcept(!is_checked_v<access>) {
+        detail::check_access<access>(!has_value());
+        return std::move(m_storage.error);
+    }
+
+    /**@brief  Non-throwing accessors*/
+    constexpr value_reference operator*(void) & noexcept { return m_storage.value; }
+    constexpr const_value_reference operator*(void) const& noexcept { return m_storage.value; }
+    constexpr T&& operator*(void) && noexcept { return std::move(m_storage.value); }
+    constexpr T* operator->(void) noexcept { return std::addressof(m_storage.value); }
+    constexpr const T* operator->(void) const noexcept { return std::addressof(m_storage.value); }
+
+    /**@brief Continue with f(value) returning an Expected, or propagate the error*/
+    template <class F>
+    constexpr auto and_then(F&& f) const& {
+        using R = std::remove_cvref_t<std::invoke_result_t<F, const T&>>;
+        return has_value() ? std::invoke(std::forward<F>(f), m_storage.value)
+                           : R(unexpect, m_storage.error);
+    }
+    template <class F>
+    constexpr auto and_then(F&& f) && {
+        using R = std::remove_cvref_t<std::invoke_result_t<F, T&&>>;
+        return has_value() ? std::invoke(std::forward<F>(f), std::move(m_storage.value))
+                           : R(unexpect, std::move(m_storage.error));
+    }
+
+    /**@brief Recover with f(error) returning an Expected, or keep the value*/
+    template <class F>
+    constexpr auto or_else(F&& f) const& {
+        using R = std::remove_cvref_t<std::invoke_result_t<F, const E&>>;
+        return has_value() ? R(in_place, m_storage.value)
+                           : std::invoke(std::forward<F>(f), m_storage.error);
+    }
+    template <class F>
+    constexpr auto or_else(F&& f) && {
+        using R = std::remove_cvref_t<std::invoke_result_t<F, E&&>>;
+        return has_value() ? R(in_place, std::move(m_storage.value))
+                           : std::invoke(std::forward<F>(f), std::move(m_storage.error));
+    }
+
+    /**@brief Map the value with f, keeping the error*/
+    template <class F>
+    constexpr auto transform(F&& f) const& {
+        using R = Expected<std::remove_cvref_t<std::invoke_result_t<F, const T&>>, E>;
+        return has_value() ? R(in_place, std::invoke(std::forward<F>(f), m_storage.value))
+                           : R(unexpect, m_storage.error);
+    }
+    template <class F>
+    constexpr auto transform(F&& f) && {
+        using R = Expected<std::remove_cvref_t<std::invoke_result_t<F, T&&>>, E>;
+        return has_value() ? R(in_place, std::invoke(std::forward<F>(f), std::move(m_storage.value)))
+                           : R(unexpect, std::move(m_storage.error));
+    }
+
+    /**@brief Map the error with f, keeping the value*/
+    template <class F>
+    constexpr auto transform_error(F&& f) const& {
+        using R = Expected<T, std::remove_cvref_t<std::invoke_result_t<F, const E&>>>;
+        return has_value() ? R(in_place, m_storage.value)
+                           : R(unexpect, std::invoke(std::forward<F>(f), m_storage.error));
+    }
+    template <class F>
+    constexpr auto transform_error(F&& f) && {
+        using R = Expected<T, std::remove_cvref_t<std::invoke_result_t<F, E&&>>>;
+        return has_value() ? R(in_place, std::move(m_storage.value))
+                           : R(unexpect, std::invoke(std::forward<F>(f), std::move(m_storage.error)));
+    }
+
+    template <class U>
+    constexpr T get_value_or(U&& other) const& {
+        return has_value() ? m_storage.value : static_cast<T>(std::forward<U>(other));
+    }
+    template <class U>
+    constexpr T get_value_or(U&& other) && {
+        return has_value() ? std::move(m_storage.value) : static_cast<T>(std::forward<U>(other));
+    }
+
+private:
+    ExpectedStorage<T, E> m_storage; ///< maybe-trivial destructor invocated storage
+};
+
+/**
+ * @brief Columnar collection of optional values.
+ * Values are stored densely in one array and engagement in a packed bitmap
+ * of one bit per element, so a disengaged element costs a bit instead of
+ * the padding of an Optional. Disengaged elements hold T{} in the value
+ * array.
+ * Bulk operations process the bitmap a word of 64 elements at a time: full
+ * words run a branch-free loop over all 64 values, empty words are skipped,
+ * and mixed words visit their set bits only.
+ */
+template <typename T>
+class OptionalVector {
+public:
+    using value_type = T;
+    using word_type = uint64_t;
+    static constexpr size_t word_bits = 64;
+
+    OptionalVector(void) = default;
+
+    /**@brief Disengaged Constructor of n elements*/
+    explicit OptionalVector(size_t n) : m_values(n), m_bitmap(words(n), 0) {}
+
+    OptionalVector(std::initializer_list<Optional<T>> opts) {
+        reserve(opts.size());
+        for (auto const& opt : opts)
+            push_back(opt);
+    }
+
+    size_t size(void) const noexcept { return m_values.size(); }
+    bool empty(void) const noexcept { return m_values.empty(); }
+
+    void reserve(size_t n) {
+        m_values.reserve(n);
+        m_bitmap.reserve(words(n));
+    }
+
+    void clear(void) noexcept {
+        m_values.clear();
+        m_bitmap.clear();
+    }
+
+    void push_back(const T& v) { m_values.push_back(v); push(true); }
+    void push_back(T&& v) { m_values.push_back(std::move(v)); push(true); }
+    void push_back(nullvalue_t) { m_values.emplace_back(); push(false); }
+    template <class N>
+    void push_back(const Optional<T, N>& opt) {
+        if (opt) push_back(*opt);
+        else push_back(nullvalue);
+    }
+
+    /**@brief Check if element i is engaged*/
+    bool has_value(size_t i) const noexcept {
+        return (m_bitmap[i / word_bits] >> (i % word_bits)) & 1;
+    }
+
+    /**@brief Element i as an Optional*/
+    Optional<T> operator[](size_t i) const {
+        if (has_value(i))
+            return Optional<T>(m_values[i]);
+        return Optional<T>(nullvalue);
+    }
+
+    /**@brief Engage element i with v*/
+    template <class U>
+    void set(size_t i, U&& v) {
+        m_values[i] = std::forward<U>(v);
+        m_bitmap[i / word_bits] |= word_type{1} << (i % word_bits);
+    }
+
+    /**@brief Disengage element i*/
+    void reset(size_t i) {
+        m_values[i] = T{};
+        m_bitmap[i / word_bits] &= ~(word_type{1} << (i % word_bits));
+    }
+
+    /**@brief Number of engaged elements*/
+    size_t count_engaged(void) const noexcept {
+        size_t n = 0;
+        for (const word_type w : m_bitmap)
+            n += static_cast<size_t>(std::popcount(w));
+        return n;
+    }
+
+    /**@brief Dense value array, T{} for disengaged elements*/
+    const T* values(void) const noexcept { return m_values.data(); }
+    T* values(void) noexcept { return m_values.data(); }
+
+    /**@brief Engagement bitmap, bits past size() are zero*/
+    const word_type* bitmap(void) const noexcept { return m_bitmap.data(); }
+    word_type* bitmap(void) noexcept { return m_bitmap.data(); }
+
+    /**
+     * @brief Call f(i) for the index of every engaged element in order.
+     * Full words of the bitmap are visited with a branch-free loop.
+     */
+    template <class F>
+    void for_each_engaged(F&& f) const {
+        const size_t n = size();
+        for (size_t w = 0; w < m_bitmap.size(); w++) {
+            word_type bits = m_bitmap[w];
+            const size_t base = w * word_bits;
+            if (bits == ~word_type{0}) {
+                for (size_t i = base; i < base + word_bits; i++)
+                    f(i);
+                continue;
+            }
+            while (bits) {
+                const size_t i = base + static_cast<size_t>(std::countr_zero(bits));
+                if (i >= n)
+                    break;
+                f(i);
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    static constexpr size_t words(size_t n) noexcept { return (n + word_bits - 1) / word_bits; }
+
+private:
+    /* Record the flag of the value just pushed, removing the value again if
+     * the bitmap cannot grow, so values and bitmap always agree.
+     */
+    void push(bool engaged) {
+        const size_t i = size() - 1;
+        if (i % word_bits == 0) {
+            try {
+                m_bitmap.push_back(0);
+            }
+            catch (...) {
+                m_values.pop_back();
+                throw;
+            }
+        }
+        m_bitmap.back() |= word_type{engaged} << (i % word_bits);
+    }
+
+    std::vector<T> m_values;
+    std::vector<word_type> m_bitmap;
+};
+
 /* F(A...) -> B
  *
  * 'Lazy' models the evalutation from a function given arguments to a value;
@@ -487,6 +1481,8 @@ public:
     using rvalue1_reference = value1_type&;
 
     using value2_type = B;
+
+    using access = access_policy_t<OneOf>;
     using value2_reference = value2_type&;
     using rvalue2_reference = value2_type&;
 
@@ -511,14 +1507,12 @@ public:
         return !m_is_value1;
     } 
 
-    constexpr value1_reference get_value1(void) {
-        if (!m_is_value1)
-            throw BadAccess();
+    constexpr value1_reference get_value1(void) noexcept(!is_checked_v<access>) {
+        detail::check_access<access>(m_is_value1);
         return *reinterpret_cast<value1_type*>(static_cast<void*>(&m_storage));
     }
-    constexpr value2_reference get_value2(void) {
-        if (m_is_value1)
-            throw BadAccess();
+    constexpr value2_reference get_value2(void) noexcept(!is_checked_v<access>) {
+        detail::check_access<access>(!m_is_value1);
         return *reinterpret_cast<value2_type*>(static_cast<void*>(&m_storage));
     }
 
@@ -0,0 +1,102 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+
+// The library-wide policy is chosen before the library is included.
+#define TINYFUNCTIONAL_ACCESS_POLICY ::f::unchecked
+#include "../../TinyFunctionalTypes.hpp"
+
+#include "../libtester-2.0.h"
+
+// Per-type policies override the library-wide one.
+template <>
+struct f::access_policy<f::Optional<long>> { using type = f::checked; };
+template <>
+struct f::access_policy<f::Expected<long, int>> { using type = f::checked; };
+template <>
+struct f::access_policy<f::OneOf<int, char>> { using type = f::assert_only; };
+
+static_assert(std::is_same_v<f::default_access_policy, f::unchecked>);
+
+// Unchecked by the macro.
+static_assert(std::is_same_v<f::Optional<int>::access, f::unchecked>);
+static_assert(noexcept(std::declval<f::Optional<int>&>().get_value()));
+static_assert(std::is_same_v<f::Expected<int, int>::access, f::unchecked>);
+static_assert(noexcept(std::declval<f::Expected<int, int>&>().get_value()));
+static_assert(noexcept(std::declval<const f::Expected<int, int>&>().get_error()));
+static_assert(noexcept(std::declval<f::Expected<int, int>&&>().get_value()));
+static_assert(std::is_same_v<f::OneOf<int, double>::access, f::unchecked>);
+static_assert(noexcept(std::declval<f::OneOf<int, double>&>().get_value1()));
+static_assert(noexcept(std::declval<f::OneOf<int, double>&>().get_value2()));
+
+// Assert only by specialization, still noexcept.
+static_assert(std::is_same_v<f::OneOf<int, char>::access, f::assert_only>);
+static_assert(noexcept(std::declval<f::OneOf<int, char>&>().get_value1()));
+
+// Checked by specialization.
+static_assert(!noexcept(std::declval<f::Optional<long>&>().get_value()));
+static_assert(!noexcept(std::declval<f::Expected<long, int>&>().get_value()));
+static_assert(!noexcept(std::declval<f::Expected<long, int>&>().get_error()));
+
+void test_policies() {
+    f::Optional<int> i{3};
+    TEST(i.get_value() == 3);
+    f::Expected<int, int> e{f::unexpect, 4};
+    TEST(e.get_error() == 4);
+    f::OneOf<int, double> o{2.5};
+    TEST(o.get_value2() == 2.5);
+    f::OneOf<int, char> c{7};
+    TEST(c.get_value1() == 7);
+
+    // The checked specializations still throw.
+    bool threw = false;
+    try { (void)f::Optional<long>().get_value(); }
+    catch (const f::BadAccess&) { threw = true; }
+    TEST(threw);
+    threw = false;
+    try { (void)f::Expected<long, int>(1L).get_error(); }
+    catch (const f::BadAccess&) { threw = true; }
+    TEST(threw);
+}
+
+// Unchecked and checked accessors kept out of line, so that
+// `objdump -d --no-show-raw-insn` shows them side by side: at -O2 the
+// unchecked one is a single load, the checked one tests the engaged flag and
+// branches to a cold throw.
+[[gnu::noinline]] int get_unchecked(const f::Optional<int>& o) {
+    return o.get_value();
+}
+
+[[gnu::noinline]] long get_checked(const f::Optional<long>& o) {
+    return o.get_value();
+}
+
+void benchmark_access() {
+    constexpr size_t N = 1 << 22;
+    std::vector<f::Optional<int>> ints(N, f::Optional<int>(1));
+    std::vector<f::Optional<long>> longs(N, f::Optional<long>(1L));
+    auto begin = std::chrono::steady_clock::now();
+    long unchecked_sum = 0;
+    for (auto const& o : ints)
+        unchecked_sum += get_unchecked(o);
+    const double unchecked_ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - begin).count();
+    begin = std::chrono::steady_clock::now();
+    long checked_sum = 0;
+    for (auto const& o : longs)
+        checked_sum += get_checked(o);
+    const double checked_ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - begin).count();
+    std::cout << "get_value: unchecked " << unchecked_ns / N << " ns, checked "
+              << checked_ns / N << " ns per call" << std::endl;
+    TEST(unchecked_sum == checked_sum);
+}
+
+int main(int argc, char** argv) {
+    ltcontext_begin(argc, argv);
+
+	TEST_UNIT(test_policies());
+	TEST_UNIT(benchmark_access());
+
+    return ltcontext_end();
+}
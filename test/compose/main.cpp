@@ -0,0 +1,208 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+
+#include "../libtester-2.0.h"
+
+#include "../../TinyFunctional.hpp"
+
+constexpr auto add1 = [](int v) { return v + 1; };
+constexpr auto mul2 = [](int v) { return v * 2; };
+constexpr auto sub3 = [](int v) { return v - 3; };
+
+void test_order() {
+    const auto composed = f::compose(add1, mul2, sub3);
+    TEST(composed(5) == sub3(mul2(add1(5))));
+    TEST(composed(5) == 9);
+
+    const auto single = f::compose(add1);
+    TEST(single(5) == 6);
+
+    const auto multi = f::compose([](int a, int b) { return a * b; }, add1);
+    TEST(multi(3, 4) == 13);
+
+    const auto to_str = f::compose(mul2, [](int v) { return std::to_string(v); });
+    TEST(to_str(21) == "42");
+}
+
+void test_state() {
+    int calls = 0;
+    const int offset = 10;
+    auto counted = f::compose([&calls](int v) { calls++; return v; },
+                              [offset](int v) { return v + offset; });
+    TEST(counted(1) == 11);
+    TEST(counted(2) == 12);
+    TEST(calls == 2);
+
+    auto mutating = f::compose([n = 0](int v) mutable { return v + n++; }, mul2);
+    TEST(mutating(1) == 2);
+    TEST(mutating(1) == 4);
+}
+
+void test_zero_overhead() {
+    // Stateless callables are empty bases of the composition.
+    static_assert(sizeof(f::compose(add1, mul2, sub3)) == 1);
+    static_assert(std::is_empty_v<decltype(f::compose(add1, mul2, sub3))>);
+    static_assert(std::is_trivially_copyable_v<decltype(f::compose(add1, mul2, sub3))>);
+
+    // Stateful callables are stored flat, without any indirection.
+    const int a = 1, b = 2;
+    const auto stateful = f::compose([a](int v) { return v + a; }, [b](int v) { return v * b; });
+    static_assert(sizeof(stateful) == 2 * sizeof(int));
+    TEST(stateful(3) == 8);
+
+    // The composition is evaluated entirely at compile time.
+    static_assert(f::compose(add1, mul2, sub3)(5) == 9);
+    constexpr auto composed = f::compose(add1, mul2, sub3);
+    static_assert(composed(0) == -1);
+}
+
+void test_copy() {
+    // A non-const composition copies, is captured by value and type erased.
+    int offset = 1;
+    auto c = f::compose([offset](int v) { return v + offset; }, mul2, sub3);
+    auto d(c);
+    auto e = c;
+    TEST(d(5) == c(5) && e(5) == 9);
+    const auto captured = [c](int v) { return c(v); };
+    TEST(captured(5) == 9);
+    std::function<int(int)> fn = c;
+    TEST(fn(5) == 9);
+    auto moved = std::move(d);
+    TEST(moved(0) == -1);
+
+    auto single = f::compose(add1);
+    auto single_copy(single);
+    TEST(single_copy(1) == 2);
+    auto counter = f::compose([n = 0](int v) mutable { return v + n++; });
+    auto counter_copy(counter);
+    TEST(counter(0) == 0 && counter(0) == 1 && counter_copy(0) == 0);
+}
+
+// Nested calls by hand and the composition doing the same, kept out of line
+// so `objdump -d --no-show-raw-insn` shows them side by side: at -O2 both
+// compile to the same single lea.
+[[gnu::noinline]] int compose_by_hand(int v) {
+    return sub3(mul2(add1(v)));
+}
+
+[[gnu::noinline]] int compose_composed(int v) {
+    return f::compose(add1, mul2, sub3)(v);
+}
+
+void benchmark_compose() {
+    constexpr int N = 1 << 22;
+    const auto time = [](auto fn, long& sum) {
+        const auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; i++)
+            sum += fn(i);
+        return std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - begin).count() / N;
+    };
+    long by_hand = 0, composed = 0;
+    const double by_hand_ns = time(compose_by_hand, by_hand);
+    const double composed_ns = time(compose_composed, composed);
+    std::cout << "compose: by hand " << by_hand_ns << " ns, composed "
+              << composed_ns << " ns per call" << std::endl;
+    TEST(by_hand == composed);
+}
+
+void test_optional_chain() {
+    const f::Optional<int> five{5};
+    const f::Optional<int> r = five | f::then(add1) | f::then(mul2) | f::then(sub3);
+    TEST(r && *r == 9);
+    const f::Optional<int> none = f::Optional<int>() | f::then(add1) | f::then(mul2);
+    TEST(!none);
+
+    // Filtering steps and steps returning an Optional end the chain disengaged.
+    const auto even = [](int v) { return v % 2 == 0; };
+    const auto half = [](int v) { return v % 2 ? f::Optional<int>() : f::Optional<int>(v / 2); };
+    TEST(!f::Optional<int>(five | f::then(add1) | f::when([](int v) { return v > 6; })));
+    TEST(*f::Optional<int>(five | f::then(add1) | f::when(even) | f::then(half)) == 3);
+    TEST(!f::Optional<int>(five | f::then(half)));
+    TEST((five | f::then(half)).get_value_or(-1) == -1);
+    TEST((five | f::then(add1) | f::then(half)).get_value_or(-1) == 3);
+
+    // Steps may change the value type, and rvalue sources are held by value.
+    const auto str = f::Optional<std::string>(std::string(50, 'x'))
+        | f::then([](std::string s) { return s + "y"; })
+        | f::then([](std::string const& s) { return s.size(); });
+    static_assert(std::is_same_v<decltype(str.evaluate()), f::Optional<size_t>>);
+    TEST(*str.evaluate() == 51);
+
+    // Non-const lvalue sources are referred to, not copied.
+    f::Optional<int> three(3);
+    const f::Optional<int> from_lvalue = three | f::then(add1);
+    TEST(*from_lvalue == 4);
+    const auto chain = three | f::then(mul2) | f::when(even);
+    three = 4;
+    TEST(*chain.evaluate() == 8);
+    f::Optional<std::string> name{std::string("name")};
+    TEST((name | f::then([](std::string const& n) { return n.size(); })).get_value_or(0) == 4);
+    TEST(name && *name == "name");
+    const f::Optional<int> constant(1);
+    TEST(*f::Optional<int>(std::move(constant) | f::then(add1)) == 2);
+
+    // Nothing is evaluated before the chain is converted.
+    int calls = 0;
+    const auto counted = five | f::then([&calls](int v) { calls++; return v; });
+    TEST(calls == 0);
+    TEST(*counted.evaluate() == 5 && calls == 1);
+
+    static_assert(*f::Optional<int>(f::Optional<int>(5) | f::then(add1) | f::then(mul2)) == 12);
+}
+
+// Hand-written if chain and the fused chain doing the same, kept out of line
+// so `objdump -d --no-show-raw-insn` shows them side by side: at -O2 all compile to
+// a single test of the engaged flag and no intermediate Optionals.
+[[gnu::noinline]] f::Optional<int> chain_by_hand(const f::Optional<int>& o) {
+    if (!o)
+        return f::nullvalue;
+    return sub3(mul2(add1(*o)));
+}
+
+[[gnu::noinline]] f::Optional<int> chain_fused(const f::Optional<int>& o) {
+    return o | f::then(add1) | f::then(mul2) | f::then(sub3);
+}
+
+[[gnu::noinline]] f::Optional<int> chain_nested(const f::Optional<int>& o) {
+    return o.transform(add1).transform(mul2).transform(sub3);
+}
+
+void benchmark_optional_chain() {
+    constexpr size_t N = 1 << 22;
+    std::vector<f::Optional<int>> inputs(N);
+    for (size_t i = 0; i < N; i++)
+        if ((i * 2654435761u) % 100 < 90)
+            inputs[i] = int(i % 1000);
+    const auto time = [&](auto chain, long& sum) {
+        const auto begin = std::chrono::steady_clock::now();
+        for (auto const& in : inputs)
+            sum += chain(in).get_value_or(0);
+        return std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - begin).count() / N;
+    };
+    long by_hand = 0, fused = 0, nested = 0;
+    const double by_hand_ns = time(chain_by_hand, by_hand);
+    const double fused_ns = time(chain_fused, fused);
+    const double nested_ns = time(chain_nested, nested);
+    std::cout << "optional chain: if chain " << by_hand_ns << " ns, fused " << fused_ns
+              << " ns, nested transform " << nested_ns << " ns per call" << std::endl;
+    TEST(by_hand == fused && fused == nested);
+}
+
+int main(int argc, char **argv) {
+    ltcontext_begin(argc, argv);
+
+	TEST_UNIT(test_order());
+	TEST_UNIT(test_state());
+	TEST_UNIT(test_zero_overhead());
+	TEST_UNIT(test_copy());
+	TEST_UNIT(benchmark_compose());
+	TEST_UNIT(test_optional_chain());
+	TEST_UNIT(benchmark_optional_chain());
+
+    return ltcontext_end();
+}
@@ -0,0 +1,287 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <numeric>
+#include <chrono>
+#include <thread>
+
+#include "../libtester-2.0.h"
+
+#include "../../TinyFunctionalParallel.hpp"
+
+bool vec_eq(auto a, auto b) {
+    if (a.size() != b.size())
+        return false;
+    return std::equal(a.begin(), a.end(), b.begin());
+};
+
+const auto plus = [](long a, long b) { return a + b; };
+
+void test_task_group() {
+    f::ThreadPool pool(f::ThreadPool::Config{4});
+    TEST(pool.concurrency() == 4);
+
+    struct CountTask : f::Task {
+        std::atomic<int>* counter;
+    };
+    std::atomic<int> counter{0};
+    std::vector<CountTask> tasks(1000);
+    f::TaskGroup group(pool);
+    for (auto& t : tasks) {
+        t.run = [](f::Task* base) { static_cast<CountTask*>(base)->counter->fetch_add(1); };
+        t.counter = &counter;
+        group.run(&t);
+    }
+    group.wait();
+    TEST(counter == 1000);
+}
+
+void test_parallel_fold() {
+    std::vector<long> longs(100000);
+    std::iota(longs.begin(), longs.end(), 1);
+    const long expected = f::foldl(plus, 0L, f::fmap([](long v) { return v; }, longs));
+
+    TEST(f::foldl(f::par, plus, 0L, longs) == expected);
+    TEST(f::foldl(f::par.with_grain(7), plus, 0L, longs) == expected);
+
+    f::ThreadPool pool(f::ThreadPool::Config{2});
+    TEST(f::foldl(f::par.on(pool), plus, 0L, longs) == expected);
+
+    const auto squares = f::fmap([](long v) { return v * v; }, longs);
+    long serial = 0;
+    for (long v : longs)
+        serial += v * v;
+    TEST(f::foldl(f::par, plus, 0L, squares) == serial);
+
+    TEST(f::foldl(f::par, plus, 5L, std::vector<long>{}) == 5);
+}
+
+void test_parallel_fmap() {
+    std::vector<int> ints(50000);
+    std::iota(ints.begin(), ints.end(), 0);
+    const auto square = [](int v) { return v * 2; };
+
+    const std::vector<int> serial = f::fmap(square, ints);
+    const auto parallel = f::fmap(f::par.with_grain(100), square, ints);
+    TEST(vec_eq(parallel, serial));
+
+    const auto strings = f::fmap<std::vector<std::string>>(f::par, [](int v) { return std::to_string(v); },
+                                                          f::take(3, ints));
+    TEST(vec_eq(strings, std::vector<std::string>({"0", "1", "2"})));
+}
+
+void test_parallel_scan() {
+    std::vector<long> longs(30000);
+    std::iota(longs.begin(), longs.end(), 0);
+    const auto serial = f::scanl(plus, 0L, longs);
+    const auto parallel = f::scanl(f::par.with_grain(64), plus, 0L, longs);
+    TEST(vec_eq(parallel, serial));
+}
+
+void test_parallel_for_each() {
+    f::ThreadPool pool(f::ThreadPool::Config{4});
+    for (const auto partition : {f::Partition::fixed, f::Partition::dynamic}) {
+        const auto policy = f::par.on(pool).with_grain(100).with_partition(partition);
+        std::vector<long> longs(10007, 1);
+        f::for_each(policy, [](long& l) { l *= 2; }, longs);
+        TEST(std::all_of(longs.begin(), longs.end(), [](long l) { return l == 2; }));
+
+        std::atomic<long> sum{0};
+        f::for_each(policy, [&](long i) { sum += i; }, f::fmap([](long l) { return l + 1; }, longs));
+        TEST(sum == 3 * 10007);
+
+        std::vector<int> empty;
+        f::for_each(policy, [](int& i) { i++; }, empty);
+        f::for_each_iterator(policy, [](long& l) { l = 0; }, longs.begin() + 7, longs.end());
+        TEST(longs[6] == 2 && longs[7] == 0 && longs.back() == 0);
+    }
+}
+
+void test_partition() {
+    f::ThreadPool pool(f::ThreadPool::Config{4});
+    // Fixed partitioning only depends on the size, chunks are cache line aligned.
+    const auto fixed = f::par.on(pool).with_grain(10);
+    const auto plan = f::detail::plan_chunks(fixed, 1000, 8);
+    TEST(plan.chunks <= pool.concurrency() * 4);
+    TEST(plan.length % 8 == 0);
+    TEST(plan.chunks * plan.length >= 1000 && (plan.chunks - 1) * plan.length < 1000);
+    const auto again = f::detail::plan_chunks(fixed, 1000, 8);
+    TEST(again.chunks == plan.chunks && again.length == plan.length);
+
+    // Dynamic partitioning uses grain sized chunks, each run exactly once.
+    const auto dynamic = fixed.with_partition(f::Partition::dynamic);
+    const auto dplan = f::detail::plan_chunks(dynamic, 1000);
+    TEST(dplan.chunks == 100 && dplan.length == 10);
+    std::vector<std::atomic<int>> runs(dplan.chunks);
+    f::detail::parallel_chunks(dynamic, dplan, [&](size_t c, size_t b, size_t e) {
+        if (b == c * 10 && e == b + 10)
+            runs[c]++;
+    });
+    TEST(std::all_of(runs.begin(), runs.end(), [](auto const& r) { return r == 1; }));
+
+    // Skewed costs give the same result with either partitioning.
+    std::vector<long> longs(2000);
+    std::iota(longs.begin(), longs.end(), 0);
+    const auto skewed = [](long acc, long l) {
+        // The first hundred elements cost a thousand times more.
+        volatile long work = 0;
+        for (long i = 0; i < (l < 100 ? 1000 : 1); i++)
+            work = work + i;
+        return acc + l;
+    };
+    TEST(f::foldl(dynamic, skewed, 0L, longs) == f::foldl(fixed, skewed, 0L, longs));
+    TEST(vec_eq(f::scanl(dynamic, plus, 0L, longs), f::scanl(plus, 0L, longs)));
+}
+
+void test_numa() {
+    TEST(vec_eq(f::NumaTopology::parse_list("0-2,5,7-8"), std::vector<int>({0, 1, 2, 5, 7, 8})));
+    TEST(f::NumaTopology::parse_list("").empty());
+    const auto& system = f::NumaTopology::system();
+    TEST(system.nodes() >= 1 && !system.cpus[0].empty());
+
+    // Without NUMA the numa partition is the fixed one.
+    f::ThreadPool uma(f::ThreadPool::Config{4});
+    TEST(uma.nodes() == 1);
+    const auto uma_plan = f::detail::plan_chunks(f::par.on(uma).with_partition(f::Partition::numa), 1000);
+    const auto fixed_plan = f::detail::plan_chunks(f::par.on(uma), 1000);
+    TEST(uma_plan.chunks == fixed_plan.chunks && uma_plan.nodes == 1);
+
+    // Two nodes on whatever cpus there are, to run the numa scheduling anywhere.
+    f::ThreadPool::Config config{4};
+    config.numa = true;
+    config.topology.cpus = {{0}, {0}};
+    f::ThreadPool pool(config);
+    TEST(pool.nodes() == 2);
+    const auto policy = f::par.on(pool).with_grain(100).with_partition(f::Partition::numa);
+    const auto plan = f::detail::plan_chunks(policy, 10000, 8);
+    TEST(plan.nodes == 2 && plan.node(0) == 0 && plan.node(plan.chunks - 1) == 1);
+
+    const auto longs = f::first_touch<long>(policy, 10000, [](size_t i) { return long(i); });
+    TEST(longs.size() == 10000 && longs[9999] == 9999);
+    const long expected = 9999L * 10000 / 2;
+    TEST(f::foldl(policy, plus, 0L, longs) == expected);
+    std::atomic<long> sum{0};
+    f::for_each(policy, [&](long l) { sum += l; }, longs);
+    TEST(sum == expected);
+}
+
+void test_cancellation() {
+    f::ThreadPool pool(f::ThreadPool::Config{4});
+    std::vector<long> ones(10000, 1);
+    f::CancellationToken token;
+    const auto policy = f::par.on(pool).with_grain(100)
+        .with_partition(f::Partition::dynamic).until(token);
+
+    const auto done = f::try_foldl(policy, plus, 0L, ones);
+    TEST(done.completed() && done.value == 10000 && done.processed == 10000);
+
+    // Cancelled half way: the partial fold covers exactly the chunks that ran.
+    std::atomic<long> seen{0};
+    const auto half = f::try_foldl(policy, [&](long acc, long l) {
+        if (++seen == 5000)
+            token.cancel();
+        return acc + l;
+    }, 0L, ones);
+    TEST(half.cancelled());
+    TEST(half.value == long(half.processed));
+    TEST(half.processed >= 5000 && half.processed < 10000);
+
+    // Already cancelled: nothing runs.
+    const auto none = f::try_fmap(policy, [](long l) { return l + 1; }, ones);
+    TEST(none.cancelled() && none.processed == 0 && none.value.size() == 10000);
+    TEST(f::for_each(policy, [](long) {}, ones) == f::Status::cancelled);
+    // The non-try overloads cannot report cancellation and reject the policy.
+    bool threw = false;
+    try { (void)f::foldl(policy, plus, 0L, ones); }
+    catch (const f::Error&) { threw = true; }
+    TEST(threw);
+    threw = false;
+    try { (void)f::fmap(policy, [](long l) { return l + 1; }, ones); }
+    catch (const f::Error&) { threw = true; }
+    TEST(threw);
+    TEST(f::foldl(policy.uncancellable(), plus, 0L, ones) == 10000);
+    // A scan ignores cancellation.
+    TEST(f::scanl(policy, plus, 0L, ones).back() == 10000);
+    token.reset();
+    TEST(f::for_each(policy, [](long) {}, ones) == f::Status::completed);
+
+    // Deadlines.
+    const auto past = f::par.on(pool).before(f::ParallelPolicy::clock::now());
+    TEST(f::try_foldl(past, plus, 0L, ones).cancelled());
+    threw = false;
+    try { (void)f::foldl(past, plus, 0L, ones); }
+    catch (const f::Error&) { threw = true; }
+    TEST(threw);
+    const auto later = f::par.on(pool).within(std::chrono::hours(1));
+    TEST(f::try_foldl(later, plus, 0L, ones).value == 10000);
+    const auto fmapped = f::try_fmap(later, [](long l) { return l + 1; }, ones);
+    TEST(fmapped.completed() && fmapped.processed == 10000 && fmapped.value[9999] == 2);
+}
+
+void test_parallel_memo() {
+    // Parallel algorithms over a memoized view evaluate every element once,
+    // also when two of them run over the same view concurrently.
+    f::ThreadPool pool(f::ThreadPool::Config{4});
+    std::vector<long> ints(20000);
+    std::iota(ints.begin(), ints.end(), 0);
+    std::atomic<size_t> calls{0};
+    const auto memo = f::fmap_memo([&](long l) { calls++; return l * 2; }, ints);
+    const auto policy = f::par.on(pool).with_grain(64).with_partition(f::Partition::dynamic);
+    long sum_a = 0, sum_b = 0;
+    std::thread other([&] { sum_a = f::foldl(policy, plus, 0L, memo); });
+    sum_b = f::foldl(policy, plus, 0L, f::fmap([](long l) { return l; }, memo));
+    other.join();
+    const long expected = 19999L * 20000;
+    TEST(sum_a == expected && sum_b == expected);
+    TEST(calls == ints.size());
+    const auto doubled = f::fmap(policy, [](long l) { return l; }, memo);
+    TEST(doubled.back() == 39998 && calls == ints.size());
+}
+
+void test_nested() {
+    std::vector<long> inner(1000, 1);
+    std::vector<int> outer(64);
+    std::iota(outer.begin(), outer.end(), 0);
+    // Nested parallel calls share the same workers.
+    f::ThreadPool pool(f::ThreadPool::Config{4});
+    const auto sums = f::fmap(f::par.on(pool).with_grain(1), [&](int) {
+        return f::foldl(f::par.on(pool).with_grain(10), plus, 0L, inner);
+    }, outer);
+    TEST(sums.size() == outer.size());
+    TEST(std::all_of(sums.begin(), sums.end(), [](long s) { return s == 1000; }));
+}
+
+void benchmark_fork_join() {
+    // Microbenchmark of task spawn and steal overhead: fork-join of empty tasks.
+    f::ThreadPool pool(f::ThreadPool::Config{4});
+    constexpr size_t N = 200000;
+    std::atomic<size_t> sink{0};
+    const auto begin = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < N / 64; round++)
+        f::detail::parallel_chunks(f::par.on(pool).with_grain(1), 64, [&](size_t, size_t b, size_t) {
+            sink.fetch_add(b, std::memory_order_relaxed);
+        });
+    const double ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - begin).count();
+    std::cout << "fork-join: " << ns / N << " ns per task on "
+              << pool.concurrency() << " workers" << std::endl;
+    TEST(sink > 0);
+}
+
+int main(int argc, char **argv) {
+    ltcontext_begin(argc, argv);
+
+	TEST_UNIT(test_task_group());
+	TEST_UNIT(test_parallel_fold());
+	TEST_UNIT(test_parallel_fmap());
+	TEST_UNIT(test_parallel_scan());
+	TEST_UNIT(test_parallel_for_each());
+	TEST_UNIT(test_partition());
+	TEST_UNIT(test_numa());
+	TEST_UNIT(test_cancellation());
+	TEST_UNIT(test_parallel_memo());
+	TEST_UNIT(test_nested());
+	TEST_UNIT(benchmark_fork_join());
+
+    return ltcontext_end();
+}
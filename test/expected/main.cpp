@@ -0,0 +1,174 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <vector>
+#include "../../TinyFunctionalTypes.hpp"
+
+#include "../libtester-2.0.h"
+
+enum class ParseError { empty, not_a_number, overflow };
+
+f::Expected<int, ParseError> parse(const std::string& s) {
+    if (s.empty())
+        return f::unexpected(ParseError::empty);
+    int out = 0;
+    for (char c : s) {
+        if (c < '0' || c > '9')
+            return f::unexpected(ParseError::not_a_number);
+        if (out > 100000000)
+            return f::unexpected(ParseError::overflow);
+        out = out * 10 + (c - '0');
+    }
+    return out;
+}
+
+static_assert(std::is_trivially_copyable_v<f::Expected<int, ParseError>>);
+static_assert(std::is_trivially_destructible_v<f::Expected<double, int>>);
+static_assert(!std::is_trivially_copyable_v<f::Expected<std::string, int>>);
+static_assert(sizeof(f::Expected<int, ParseError>) == 2 * sizeof(int));
+
+void test_value_error() {
+    const auto ok = parse("42");
+    TEST(ok && ok.has_value() && *ok == 42 && ok.get_value() == 42);
+    const auto bad = parse("4x");
+    TEST(!bad && bad.get_error() == ParseError::not_a_number);
+    TEST(parse("").get_error() == ParseError::empty);
+    TEST(bad.get_value_or(-1) == -1);
+
+    bool threw = false;
+    try { (void)bad.get_value(); }
+    catch (const f::BadAccess&) { threw = true; }
+    TEST(threw);
+    threw = false;
+    try { (void)ok.get_error(); }
+    catch (const f::BadAccess&) { threw = true; }
+    TEST(threw);
+
+    f::Expected<std::string, int> s{f::in_place, 3, 'a'};
+    TEST(s && *s == "aaa" && s->size() == 3);
+    f::Expected<std::string, int> e{f::unexpect, 7};
+    TEST(!e && e.get_error() == 7);
+    // Copies and assignments switch between value and error.
+    auto c = s;
+    c = e;
+    TEST(!c && c.get_error() == 7);
+    c = s;
+    TEST(c && *c == "aaa");
+    c = f::Expected<std::string, int>(std::string("moved"));
+    TEST(*c == "moved");
+}
+
+void test_monadic() {
+    const auto half = [](int n) -> f::Expected<int, ParseError> {
+        if (n % 2) return f::unexpected(ParseError::not_a_number);
+        return n / 2;
+    };
+    TEST(*parse("8").and_then(half).and_then(half) == 2);
+    TEST(parse("6").and_then(half).and_then(half).get_error() == ParseError::not_a_number);
+    TEST(parse("x").and_then(half).get_error() == ParseError::not_a_number);
+
+    const auto recovered = parse("").or_else([](ParseError) -> f::Expected<int, ParseError> {
+        return 0;
+    });
+    TEST(recovered && *recovered == 0);
+    TEST(*parse("5").or_else([](ParseError) -> f::Expected<int, ParseError> { return 0; }) == 5);
+
+    const auto doubled = parse("21").transform([](int n) { return n * 2.0; });
+    TEST(doubled && *doubled == 42.0);
+    const auto message = parse("").transform_error([](ParseError e) {
+        return e == ParseError::empty ? std::string("empty") : std::string("other");
+    });
+    TEST(!message && message.get_error() == "empty");
+    TEST(*parse("3").transform_error([](ParseError) { return 0; }) == 3);
+
+    f::Expected<std::string, int> owned{std::string(100, 'x')};
+    const auto length = std::move(owned).transform([](std::string s) { return s.size(); });
+    TEST(*length == 100);
+}
+
+struct ThrowingCopy {
+    static inline bool fail = false;
+    int code;
+    explicit ThrowingCopy(int code) : code(code) {}
+    ThrowingCopy(const ThrowingCopy& other) : code(other.code) {
+        if (fail)
+            throw f::Error("copy failed");
+    }
+    ThrowingCopy& operator=(const ThrowingCopy&) = default;
+};
+
+struct ThrowingCopyNothrowMove : ThrowingCopy {
+    using ThrowingCopy::ThrowingCopy;
+    ThrowingCopyNothrowMove(const ThrowingCopyNothrowMove&) = default;
+    ThrowingCopyNothrowMove(ThrowingCopyNothrowMove&& other) noexcept : ThrowingCopy(other.code) {}
+    ThrowingCopyNothrowMove& operator=(const ThrowingCopyNothrowMove&) = default;
+};
+
+template <class E>
+void check_throwing_switch() {
+    // A throwing switch from value to error keeps the value, and the reverse.
+    f::Expected<std::string, E> value{std::string(100, 'v')};
+    f::Expected<std::string, E> error{f::unexpect, 3};
+    ThrowingCopy::fail = true;
+    bool threw = false;
+    try { value = error; }
+    catch (const f::Error&) { threw = true; }
+    ThrowingCopy::fail = false;
+    TEST(threw && value && *value == std::string(100, 'v'));
+
+    value = error;
+    TEST(!value && value.get_error().code == 3);
+    f::Expected<std::string, E> other{std::string("back")};
+    value = other;
+    TEST(value && *value == "back");
+}
+
+void test_throwing_assignment() {
+    check_throwing_switch<ThrowingCopy>();
+    check_throwing_switch<ThrowingCopyNothrowMove>();
+}
+
+int parse_or_throw(const std::string& s) {
+    const auto e = parse(s);
+    if (!e)
+        throw f::Error("parse error");
+    return *e;
+}
+
+void benchmark_error_rates() {
+    // Error handling by value against exceptions at several error rates.
+    constexpr size_t N = 200000;
+    for (const int percent : {1, 10, 50}) {
+        std::vector<std::string> inputs;
+        for (size_t i = 0; i < N; i++)
+            inputs.push_back(int((i * 2654435761u) % 100) < percent ? "bad" : std::to_string(i % 1000));
+        auto begin = std::chrono::steady_clock::now();
+        long expected_sum = 0;
+        for (auto const& in : inputs)
+            expected_sum += parse(in).get_value_or(0);
+        const double expected_ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - begin).count();
+        begin = std::chrono::steady_clock::now();
+        long thrown_sum = 0;
+        for (auto const& in : inputs) {
+            try { thrown_sum += parse_or_throw(in); }
+            catch (const f::Error&) {}
+        }
+        const double thrown_ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - begin).count();
+        std::cout << percent << "% errors: Expected " << expected_ns / N << " ns, exceptions "
+                  << thrown_ns / N << " ns per call" << std::endl;
+        TEST(expected_sum == thrown_sum);
+    }
+}
+
+int main(int argc, char** argv) {
+    ltcontext_begin(argc, argv);
+
+	TEST_UNIT(test_value_error());
+	TEST_UNIT(test_monadic());
+	TEST_UNIT(test_throwing_assignment());
+	TEST_UNIT(benchmark_error_rates());
+
+    return ltcontext_end();
+}
@@ -85,6 +85,19 @@ void test_sum_of_squares(void) {
     TEST(ssq == 1*1 + 2*2 + 3*3 + 4*4 + 5*5);
 }
 
+void test_scan() {
+    const auto plus = [](auto a, auto b) {return a + b;};
+    const std::vector<int> ints{1,2,3,4,5};
+    const auto sums = f::scanl(plus, 0, ints);
+    vec_print("running sums", sums);
+    TEST(vec_eq(sums, std::vector<int>({1, 3, 6, 10, 15})));
+
+    const auto lazy_sums = f::scanl(plus, 10, f::take(2, ints));
+    TEST(vec_eq(lazy_sums, std::vector<int>({11, 13})));
+
+    TEST(f::scanl(plus, 0, std::vector<int>{}).empty());
+}
+
 int main(int argc, char **argv) {
     ltcontext_begin(argc, argv);
 
@@ -92,6 +105,7 @@ int main(int argc, char **argv) {
 	TEST_UNIT(test_concatenate());
 	TEST_UNIT(test_reverse());
 	TEST_UNIT(test_sum_of_squares());
+	TEST_UNIT(test_scan());
 
     return ltcontext_end();
 }
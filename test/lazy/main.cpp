@@ -0,0 +1,298 @@
+#include <iostream>
+#include <vector>
+#include <list>
+#include <array>
+#include <set>
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <sstream>
+#include <numeric>
+
+#include "../libtester-2.0.h"
+
+#include "../../TinyFunctional.hpp"
+
+bool vec_eq(auto a, auto b) {
+    if (a.size() != b.size())
+        return false;
+    return std::equal(a.begin(), a.end(), b.begin());
+};
+
+auto vec_str(const std::string name, auto vec) {
+    std::stringstream ss{""};
+    if (vec.empty()) {
+        ss << name << ": <empty>";
+        return ss.str();
+    }
+    ss << name << ": {"; 
+    for (auto v: vec)
+        ss << v << " "; 
+    ss << "}"; 
+    return ss.str();
+};
+
+auto vec_print(const std::string name, auto vec) {
+    std::cout << vec_str(name, vec) << std::endl;
+};
+
+const auto is_odd = [](int v) { return v % 2 != 0; };
+const auto square = [](int v) { return v*v; };
+
+void test_filter() {
+    const std::vector<int> ints{1,2,3,4,5,6,7};
+    std::vector<int> odds = f::filter(is_odd, ints);
+    vec_print("odds", odds);
+    TEST(vec_eq(odds, std::vector<int>({1, 3, 5, 7})));
+}
+
+void test_take_drop() {
+    const std::vector<int> ints{1,2,3,4,5};
+    std::vector<int> first = f::take(3, ints);
+    vec_print("take 3", first);
+    TEST(vec_eq(first, std::vector<int>({1, 2, 3})));
+
+    std::vector<int> all = f::take(10, ints);
+    TEST(vec_eq(all, ints));
+
+    std::vector<int> none = f::take(0, ints);
+    TEST(none.empty());
+
+    std::vector<int> rest = f::drop(3, ints);
+    vec_print("drop 3", rest);
+    TEST(vec_eq(rest, std::vector<int>({4, 5})));
+
+    std::vector<int> empty = f::drop(10, ints);
+    TEST(empty.empty());
+
+    const std::list<int> linked{1,2,3,4,5};
+    std::vector<int> lrest = f::drop(2, linked);
+    TEST(vec_eq(lrest, std::vector<int>({3, 4, 5})));
+}
+
+void test_take_while() {
+    const std::vector<int> ints{1,3,5,6,7,9};
+    std::vector<int> leading = f::take_while(is_odd, ints);
+    vec_print("take_while odd", leading);
+    TEST(vec_eq(leading, std::vector<int>({1, 3, 5})));
+}
+
+void test_stride() {
+    const std::vector<int> ints{0,1,2,3,4,5,6,7};
+    std::vector<int> every3 = f::stride(3, ints);
+    vec_print("stride 3", every3);
+    TEST(vec_eq(every3, std::vector<int>({0, 3, 6})));
+
+    const std::list<int> linked{0,1,2,3,4,5,6,7};
+    std::vector<int> levery3 = f::stride(3, linked);
+    TEST(vec_eq(levery3, std::vector<int>({0, 3, 6})));
+
+    std::vector<int> strided = f::stride(2, f::filter(is_odd, ints));
+    TEST(vec_eq(strided, std::vector<int>({1, 5})));
+}
+
+void test_filter_map_take() {
+    std::vector<int> ints(1000);
+    for (int i = 0; i < 1000; i++)
+        ints[i] = i;
+
+    int squared = 0;
+    const auto counted_square = [&](int v) { squared++; return v*v; };
+    auto query = f::take(3, f::fmap(counted_square, f::filter(is_odd, ints)));
+    TEST(squared == 0);
+
+    std::vector<int> result = query;
+    vec_print("filter-map-take", result);
+    TEST(vec_eq(result, std::vector<int>({1, 9, 25})));
+    TEST(squared == 3);
+}
+
+void test_fold_for_each() {
+    const std::vector<int> ints{1,2,3,4,5};
+    const auto plus = [](int a, int b) { return a + b; };
+
+    const auto sum = f::foldl(plus, 0, f::fmap(square, f::filter(is_odd, ints)));
+    TEST(sum == 1 + 9 + 25);
+
+    const auto dropped = f::foldl(plus, 0, f::drop(1, f::take(4, ints)));
+    TEST(dropped == 2 + 3 + 4);
+
+    std::vector<int> seen;
+    f::for_each([&](int v) { seen.push_back(v); }, f::take(2, f::filter(is_odd, ints)));
+    TEST(vec_eq(seen, std::vector<int>({1, 3})));
+}
+
+void test_zip_with() {
+    const std::vector<int> a{1,2,3,4};
+    const std::vector<int> b{5,6,7};
+    const auto plus = [](int x, int y) { return x + y; };
+    const auto mult = [](int x, int y) { return x * y; };
+
+    std::vector<int> sums = f::zip_with(plus, a, b);
+    vec_print("zip_with +", sums);
+    TEST(vec_eq(sums, std::vector<int>({6, 8, 10})));
+
+    const auto dot = f::foldl(plus, 0, f::zip_with(mult, a, b));
+    TEST(dot == 1*5 + 2*6 + 3*7);
+
+    const std::list<int> linked{10,20,30,40,50};
+    const std::vector<double> weights{0.5, 0.25, 2.0, 1.0};
+    std::vector<double> mixed = f::zip_with([](int x, int y, double w) { return (x + y) * w; },
+                                            a, linked, weights);
+    vec_print("zip_with 3", mixed);
+    TEST(vec_eq(mixed, std::vector<double>({5.5, 5.5, 66.0, 44.0})));
+
+    std::vector<int> first = f::take(2, f::zip_with(mult, a, linked));
+    TEST(vec_eq(first, std::vector<int>({10, 40})));
+}
+
+void test_flat_map() {
+    const std::vector<std::string> lines{"a b", "", "c d e"};
+    const auto tokenize = [](const std::string& line) {
+        std::vector<std::string> tokens;
+        std::stringstream ss{line};
+        for (std::string token; ss >> token; )
+            tokens.push_back(token);
+        return tokens;
+    };
+
+    std::vector<std::string> tokens = f::flat_map(tokenize, lines);
+    vec_print("flat_map tokens", tokens);
+    TEST(vec_eq(tokens, std::vector<std::string>({"a", "b", "c", "d", "e"})));
+
+    const auto expanded = f::flat_map(tokenize, lines);
+    TEST(expanded.size() == 5);
+    const auto sized = expanded.get<std::vector<std::string>>(expanded.size());
+    TEST(sized.capacity() == 5);
+    TEST(vec_eq(sized, tokens));
+
+    const std::vector<int> ints{1,2,3};
+    const auto prefix = [&](int v) { return f::take(v, ints); };
+    std::vector<int> prefixes = f::take(5, f::flat_map(prefix, ints));
+    vec_print("flat_map prefixes", prefixes);
+    TEST(vec_eq(prefixes, std::vector<int>({1, 1, 2, 1, 2})));
+}
+
+void test_materialization() {
+    const std::vector<int> ints{5,3,1,4,2};
+
+    std::array<int, 3> first3 = f::fmap(square, ints);
+    TEST(vec_eq(first3, std::array<int, 3>({25, 9, 1})));
+
+    std::array<int, 7> padded = f::fmap(square, ints);
+    TEST(vec_eq(padded, std::array<int, 7>({25, 9, 1, 16, 4, 0, 0})));
+
+    std::set<int> sorted = f::fmap(square, ints);
+    TEST(vec_eq(sorted, std::set<int>({1, 4, 9, 16, 25})));
+
+    const auto to_entry = [](int v) { return std::pair<const int, int>(v, v*v); };
+    std::map<int, int> squares = f::fmap(to_entry, ints);
+    TEST(squares.size() == 5);
+    TEST(squares[4] == 16);
+
+    std::unordered_map<int, int> hashed = f::fmap(to_entry, ints);
+    TEST(hashed.size() == 5);
+    // The map is reserved up front: it has the buckets of a map reserved for
+    // all elements, rather than those grown by rehashing on insertion.
+    std::vector<int> many(1000);
+    std::iota(many.begin(), many.end(), 0);
+    const std::unordered_map<int, int> hashed_many = f::fmap(to_entry, many);
+    std::unordered_map<int, int> reserved_many;
+    reserved_many.reserve(many.size());
+    std::unordered_map<int, int> grown_many;
+    for (int v : many)
+        grown_many.insert(to_entry(v));
+    TEST(hashed_many.size() == many.size());
+    TEST(hashed_many.bucket_count() == reserved_many.bucket_count());
+    TEST(hashed_many.bucket_count() <= grown_many.bucket_count());
+    TEST(hashed[3] == 9);
+
+    const std::vector<int> codes{104, 105, 33};
+    std::string str = f::fmap([](int c) { return char(c); }, codes);
+    TEST(str == "hi!");
+
+    const auto reserved = f::fmap(square, ints).get<std::vector<int>>();
+    TEST(reserved.capacity() == ints.size());
+}
+
+void test_fmap_memo() {
+    const std::vector<int> ints{1,2,3,4,5};
+    int evaluations = 0;
+    const auto counted_square = [&](int v) { evaluations++; return v*v; };
+
+    auto memo = f::fmap_memo(counted_square, ints);
+    TEST(evaluations == 0);
+
+    std::vector<int> first2 = f::take(2, memo);
+    TEST(vec_eq(first2, std::vector<int>({1, 4})));
+    TEST(evaluations == 2);
+    TEST(memo.has_evaluated(1));
+    TEST(!memo.has_evaluated(2));
+
+    std::vector<int> all = memo;
+    TEST(vec_eq(all, std::vector<int>({1, 4, 9, 16, 25})));
+    TEST(evaluations == 5);
+
+    const auto plus = [](int a, int b) { return a + b; };
+    TEST(f::foldl(plus, 0, memo) == 55);
+    std::vector<int> again = f::fmap([](int v) { return v + 1; }, memo);
+    TEST(vec_eq(again, std::vector<int>({2, 5, 10, 17, 26})));
+    TEST(evaluations == 5);
+
+    memo.reset();
+    TEST(!memo.has_evaluated(0));
+    std::vector<int> reevaluated = memo;
+    TEST(evaluations == 10);
+
+    const std::vector<std::string> names{"ab", "cde"};
+    auto upper = f::fmap_memo([](const std::string& n) { return n + n; }, names);
+    std::vector<std::string> doubled = upper;
+    TEST(vec_eq(doubled, std::vector<std::string>({"abab", "cdecde"})));
+}
+
+void test_elementwise() {
+    const std::vector<double> a{1.0, 2.0, 3.0, 4.0};
+    const std::vector<double> b{4.0, 3.0, 2.0, 1.0};
+    const auto id = [](double v) { return v; };
+    const auto la = f::fmap(id, a);
+    const auto lb = f::fmap(id, b);
+
+    std::vector<double> c = la + lb * 2.0;
+    vec_print("a + b * 2", c);
+    TEST(vec_eq(c, std::vector<double>({9.0, 8.0, 7.0, 6.0})));
+
+    std::vector<double> d = f::max(la, b) - 1.0;
+    TEST(vec_eq(d, std::vector<double>({3.0, 2.0, 2.0, 3.0})));
+
+    std::vector<double> e = 10.0 / -f::min(la, lb);
+    TEST(vec_eq(e, std::vector<double>({-10.0, -5.0, -5.0, -10.0})));
+
+    int evaluations = 0;
+    const auto counted = [&](double v) { evaluations++; return v; };
+    auto expr = f::fmap(counted, a) * f::fmap(counted, b);
+    TEST(evaluations == 0);
+    const auto plus = [](double x, double y) { return x + y; };
+    TEST(f::foldl(plus, 0.0, expr) == 4.0 + 6.0 + 6.0 + 4.0);
+    TEST(evaluations == 8);
+
+    std::vector<double> dropped = f::drop(2, la) + f::take(2, lb);
+    TEST(vec_eq(dropped, std::vector<double>({7.0, 7.0})));
+}
+
+int main(int argc, char **argv) {
+    ltcontext_begin(argc, argv);
+
+	TEST_UNIT(test_filter());
+	TEST_UNIT(test_take_drop());
+	TEST_UNIT(test_take_while());
+	TEST_UNIT(test_stride());
+	TEST_UNIT(test_filter_map_take());
+	TEST_UNIT(test_fold_for_each());
+	TEST_UNIT(test_zip_with());
+	TEST_UNIT(test_flat_map());
+	TEST_UNIT(test_materialization());
+	TEST_UNIT(test_fmap_memo());
+	TEST_UNIT(test_elementwise());
+
+    return ltcontext_end();
+}
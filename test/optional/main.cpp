@@ -4,6 +4,15 @@
 #include "../libtester-2.0.h"
 
 #include <optional>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+// Per-type access policies, selected before the types are used.
+template <>
+struct f::access_policy<f::Optional<long>> { using type = f::unchecked; };
+template <>
+struct f::access_policy<f::Optional<short>> { using type = f::assert_only; };
 
 struct Person {
     std::string name; int age;
@@ -278,6 +287,30 @@ void test_or_else() {
     TEST(*num = 42);
 }
 
+void test_transform_filter() {
+    const auto half = f::Optional<int>(42).transform([](int n) { return n / 2.0; });
+    static_assert(std::is_same_v<decltype(half), const f::Optional<double>>);
+    TEST(half && *half == 21.0);
+    TEST(!f::Optional<int>().transform([](int n) { return n / 2.0; }));
+
+    const auto even = [](int n) { return n % 2 == 0; };
+    TEST(*f::Optional<int>(4).filter(even) == 4);
+    TEST(!f::Optional<int>(3).filter(even));
+    TEST(!f::Optional<int>().filter(even));
+
+    f::Optional<std::string> owned{std::string(100, 'x')};
+    const auto length = std::move(owned).transform([](std::string s) { return s.size(); });
+    TEST(*length == 100);
+    const auto kept = f::Optional<std::string>("kept").filter([](auto const& s) { return !s.empty(); });
+    TEST(*kept == "kept");
+
+    std::vector<Person> people{Person("alex", 24)};
+    f::Optional<Person&> alex = people[0];
+    TEST(*alex.transform([](Person& p) { return p.age; }) == 24);
+    TEST(&*alex.filter([](Person& p) { return p.age > 18; }) == &people[0]);
+    TEST(!alex.filter([](Person& p) { return p.age > 30; }));
+}
+
 void test_get_value_or() {
     f::Optional<int> num = f::nullvalue;
     int d = num.get_value_or(3);
@@ -309,6 +342,235 @@ void example_usage1() {
 }
 
 
+// Triviality propagates from T through Storage to Optional.
+static_assert(std::is_trivially_copyable_v<f::Optional<int>>);
+static_assert(std::is_trivially_destructible_v<f::Optional<int>>);
+static_assert(std::is_trivially_copy_constructible_v<f::Optional<double>>);
+static_assert(std::is_trivially_move_assignable_v<f::Optional<double>>);
+static_assert(std::is_trivially_copyable_v<f::Storage<int*>>);
+static_assert(!std::is_trivially_copyable_v<f::Optional<std::string>>);
+static_assert(!std::is_trivially_destructible_v<f::Optional<std::string>>);
+static_assert(std::is_copy_constructible_v<f::Optional<std::string>>);
+static_assert(std::is_nothrow_move_constructible_v<f::Optional<std::string>>);
+
+void test_trivially_copyable() {
+    std::vector<f::Optional<int>> opts{f::Optional<int>(1), f::Optional<int>(), f::Optional<int>(3)};
+    std::vector<f::Optional<int>> copy(opts.size());
+    std::memcpy(copy.data(), opts.data(), opts.size() * sizeof(f::Optional<int>));
+    TEST(copy[0] && *copy[0] == 1);
+    TEST(!copy[1]);
+    TEST(copy[2] && *copy[2] == 3);
+
+    f::Optional<std::string> s{std::string("alex")};
+    f::Optional<std::string> c = s;
+    TEST(c && *c == "alex");
+    f::Optional<std::string> e;
+    c = e;
+    TEST(!c);
+    c = s;
+    TEST(c && *c == "alex");
+    f::Optional<std::string> m = std::move(s);
+    TEST(m && *m == "alex");
+}
+
+[[gnu::noinline]] f::Optional<int> hot_optional(int i) {
+    if (i % 7 == 0)
+        return f::nullvalue;
+    return f::Optional<int>(i);
+}
+
+[[gnu::noinline]] std::optional<int> hot_std_optional(int i) {
+    if (i % 7 == 0)
+        return std::nullopt;
+    return i;
+}
+
+void benchmark_return_optional() {
+    // A trivially copyable Optional<int> is returned in registers like std::optional.
+    constexpr int N = 10000000;
+    const auto time = [](auto&& body) {
+        const auto begin = std::chrono::steady_clock::now();
+        const long sum = body();
+        const double ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - begin).count();
+        return std::make_pair(sum, ns / N);
+    };
+    const auto [fsum, fns] = time([] {
+        long sum = 0;
+        for (int i = 0; i < N; i++)
+            if (const auto o = hot_optional(i))
+                sum += *o;
+        return sum;
+    });
+    const auto [ssum, sns] = time([] {
+        long sum = 0;
+        for (int i = 0; i < N; i++)
+            if (const auto o = hot_std_optional(i))
+                sum += *o;
+        return sum;
+    });
+    std::cout << "return f::Optional<int>: " << fns << " ns, std::optional<int>: "
+              << sns << " ns" << std::endl;
+    TEST(fsum == ssum);
+}
+
+enum class Color { red, green, blue, none };
+
+static_assert(sizeof(f::Optional<int, f::sentinel<-1>>) == sizeof(int));
+static_assert(sizeof(f::Optional<double, f::nan_niche>) == sizeof(double));
+static_assert(sizeof(f::CompactOptional<double>) == sizeof(double));
+static_assert(sizeof(f::CompactOptional<Person*>) == sizeof(Person*));
+static_assert(sizeof(f::Optional<Color, f::sentinel<Color::none>>) == sizeof(Color));
+static_assert(sizeof(f::CompactOptional<int>) == sizeof(f::Optional<int>));
+static_assert(std::is_trivially_copyable_v<f::CompactOptional<double>>);
+
+void test_niche() {
+    f::Optional<int, f::sentinel<-1>> i;
+    TEST(!i);
+    i = 4;
+    TEST(i && *i == 4);
+    i = f::nullvalue;
+    TEST(!i);
+    TEST(i.get_value_or(7) == 7);
+    // The sentinel itself is the disengaged state.
+    i = -1;
+    TEST(!i);
+
+    f::CompactOptional<double> d{2.5};
+    TEST(d && d.get_value() == 2.5);
+    d.reset();
+    TEST(!d);
+    bool threw = false;
+    try { (void)d.get_value(); }
+    catch (const f::BadAccess&) { threw = true; }
+    TEST(threw);
+
+    Person alex("alex", 24);
+    f::CompactOptional<Person*> p;
+    TEST(!p);
+    p = &alex;
+    TEST(p && (*p)->age == 24);
+
+    f::Optional<Color, f::sentinel<Color::none>> c{Color::blue};
+    TEST(c && *c == Color::blue);
+    const auto doubled = f::Optional<int, f::sentinel<-1>>(21).and_then([](int n) {
+        return f::Optional<int>(n * 2);
+    });
+    TEST(doubled && *doubled == 42);
+
+    // Conversion between niche and regular layouts.
+    f::Optional<int> regular = f::Optional<int, f::sentinel<-1>>(5);
+    TEST(regular && *regular == 5);
+    f::Optional<int> empty = f::Optional<int, f::sentinel<-1>>();
+    TEST(!empty);
+}
+
+struct Counted {
+    static inline int copies = 0;
+    static inline int moves = 0;
+    std::string payload;
+    int id;
+    Counted(std::string payload, int id) : payload(std::move(payload)), id(id) {}
+    Counted(const Counted& c) : payload(c.payload), id(c.id) { copies++; }
+    Counted(Counted&& c) noexcept : payload(std::move(c.payload)), id(c.id) { moves++; }
+    Counted& operator=(const Counted& c) { payload = c.payload; id = c.id; copies++; return *this; }
+    Counted& operator=(Counted&& c) noexcept { payload = std::move(c.payload); id = c.id; moves++; return *this; }
+};
+
+void test_in_place() {
+    Counted::copies = Counted::moves = 0;
+    f::Optional<Counted> a{f::in_place, std::string(1000, 'a'), 1};
+    TEST(a && a->id == 1);
+    auto b = f::make_optional<Counted>(std::string(1000, 'b'), 2);
+    TEST(b && b->id == 2);
+    TEST(Counted::copies == 0 && Counted::moves == 0);
+
+    auto& c = a.emplace(std::string(10, 'c'), 3);
+    TEST(&c == &*a && a->id == 3 && a->payload == "cccccccccc");
+    TEST(Counted::copies == 0 && Counted::moves == 0);
+
+    // Rvalue assignment moves, into an engaged and a disengaged optional.
+    a = Counted("d", 4);
+    TEST(a->id == 4 && Counted::copies == 0 && Counted::moves == 1);
+    f::Optional<Counted> e;
+    e = Counted("e", 5);
+    TEST(e && e->id == 5 && Counted::copies == 0 && Counted::moves == 2);
+    e = std::move(b);
+    TEST(e->id == 2 && Counted::copies == 0 && Counted::moves == 3);
+
+    const Counted f("f", 6);
+    e = f;
+    TEST(e->id == 6 && Counted::copies == 1);
+
+    f::Optional<int, f::sentinel<-1>> n{f::in_place, 3};
+    TEST(n && n.emplace(8) == 8 && *n == 8);
+}
+
+static_assert(sizeof(f::Optional<Person&>) == sizeof(Person*));
+static_assert(std::is_trivially_copyable_v<f::Optional<Person&>>);
+static_assert(!std::is_constructible_v<f::Optional<const std::string&>, std::string&&>);
+
+f::Optional<Person&> find_person(std::vector<Person>& people, const std::string& name) {
+    for (auto& p : people)
+        if (p.name == name)
+            return p;
+    return f::nullvalue;
+}
+
+void test_optional_reference() {
+    std::vector<Person> people{Person("alex", 24), Person("bob", 22)};
+    auto bob = find_person(people, "bob");
+    TEST(bob && &*bob == &people[1]);
+    bob->age = 23;
+    TEST(people[1].age == 23);
+    TEST(!find_person(people, "carl"));
+
+    // Assignment rebinds instead of assigning through.
+    bob = people[0];
+    TEST(&bob.get_value() == &people[0] && people[1].name == "bob");
+    bob = f::nullvalue;
+    TEST(!bob);
+    bool threw = false;
+    try { (void)bob.get_value(); }
+    catch (const f::BadAccess&) { threw = true; }
+    TEST(threw);
+
+    Person nobody("nobody", 0);
+    TEST(&find_person(people, "carl").get_value_or(nobody) == &nobody);
+    TEST(&find_person(people, "alex").get_value_or(nobody) == &people[0]);
+    const Person copy = find_person(people, "carl").get_value_or(Person("temp", 1));
+    TEST(copy.name == "temp");
+
+    const auto age = find_person(people, "alex").and_then([](Person& p) {
+        return f::Optional<int>(p.age);
+    });
+    TEST(age && *age == 24);
+    auto fallback = find_person(people, "carl").or_else([&]() -> Person& { return nobody; });
+    TEST(&*fallback == &nobody);
+
+    f::Optional<const Person&> view = find_person(people, "bob");
+    TEST(view && view->age == 23);
+    f::Optional<Person> owned = find_person(people, "bob");
+    TEST(owned && owned->name == "bob" && &*owned != &people[1]);
+}
+
+static_assert(!noexcept(std::declval<f::Optional<int>&>().get_value()));
+static_assert(noexcept(std::declval<f::Optional<long>&>().get_value()));
+static_assert(noexcept(std::declval<f::Optional<short>&>().get_value()));
+static_assert(std::is_same_v<f::Optional<int>::access, f::checked>);
+
+void test_access_policy() {
+    f::Optional<long> l{5L};
+    TEST(l.get_value() == 5);
+    f::Optional<short> s{short(3)};
+    TEST(std::move(s).get_value() == 3);
+    // The checked policy still throws.
+    f::Optional<int> i;
+    bool threw = false;
+    try { (void)i.get_value(); }
+    catch (const f::BadAccess&) { threw = true; }
+    TEST(threw);
+}
 
 int main(int argc, char** argv) {
     ltcontext_begin(argc, argv);
@@ -322,8 +584,15 @@ int main(int argc, char** argv) {
 	TEST_UNIT(test_loud_destruct());
 	TEST_UNIT(test_and_then());
 	TEST_UNIT(test_or_else());
+	TEST_UNIT(test_transform_filter());
 	TEST_UNIT(test_get_value_or());
 	TEST_UNIT(example_usage1());
+	TEST_UNIT(test_trivially_copyable());
+	TEST_UNIT(benchmark_return_optional());
+	TEST_UNIT(test_niche());
+	TEST_UNIT(test_in_place());
+	TEST_UNIT(test_optional_reference());
+	TEST_UNIT(test_access_policy());
 
     return ltcontext_end();
 }
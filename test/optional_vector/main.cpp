@@ -0,0 +1,212 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <optional>
+
+#include "../libtester-2.0.h"
+
+#include "../../TinyFunctional.hpp"
+
+bool vec_eq(auto a, auto b) {
+    if (a.size() != b.size())
+        return false;
+    return std::equal(a.begin(), a.end(), b.begin());
+};
+
+void test_push_access() {
+    f::OptionalVector<double> v;
+    TEST(v.empty());
+    v.push_back(1.5);
+    v.push_back(f::nullvalue);
+    v.push_back(f::Optional<double>(3.5));
+    v.push_back(f::Optional<double>());
+    TEST(v.size() == 4);
+    TEST(v.has_value(0) && !v.has_value(1) && v.has_value(2) && !v.has_value(3));
+    TEST(v[0] && *v[0] == 1.5);
+    TEST(!v[1]);
+    TEST(v.count_engaged() == 2);
+
+    v.set(1, 2.5);
+    v.reset(0);
+    TEST(!v[0] && *v[1] == 2.5);
+    TEST(v.count_engaged() == 2);
+
+    f::OptionalVector<int> list{f::Optional<int>(1), f::Optional<int>(), f::Optional<int>(3)};
+    TEST(list.size() == 3 && list.count_engaged() == 2);
+    f::OptionalVector<int> empty(100);
+    TEST(empty.size() == 100 && empty.count_engaged() == 0);
+}
+
+struct ThrowingCopy {
+    static inline bool fail = false;
+    int v = 0;
+    ThrowingCopy(void) = default;
+    explicit ThrowingCopy(int v) : v(v) {}
+    ThrowingCopy(const ThrowingCopy& other) : v(other.v) {
+        if (fail)
+            throw f::Error("copy failed");
+    }
+    ThrowingCopy(ThrowingCopy&&) noexcept = default;
+    ThrowingCopy& operator=(const ThrowingCopy&) = default;
+};
+
+void test_push_throws() {
+    // A throwing push leaves values and bitmap in agreement, also on a word boundary.
+    f::OptionalVector<ThrowingCopy> v;
+    for (int i = 0; i < 64; i++)
+        v.push_back(ThrowingCopy(i));
+    const ThrowingCopy extra(64);
+    ThrowingCopy::fail = true;
+    bool threw = false;
+    try { v.push_back(extra); }
+    catch (const f::Error&) { threw = true; }
+    ThrowingCopy::fail = false;
+    TEST(threw && v.size() == 64 && v.count_engaged() == 64);
+    v.push_back(f::nullvalue);
+    v.push_back(extra);
+    TEST(v.size() == 66 && !v.has_value(64) && v.has_value(65) && v[65]->v == 64);
+    TEST(v.count_engaged() == 65);
+}
+
+f::OptionalVector<int> every_third_null(size_t n) {
+    f::OptionalVector<int> v;
+    for (size_t i = 0; i < n; i++) {
+        if (i % 3 == 0)
+            v.push_back(f::nullvalue);
+        else
+            v.push_back(int(i));
+    }
+    return v;
+}
+
+void test_bulk_ops() {
+    // Sizes around word boundaries, with full, empty and mixed words.
+    for (size_t n : {0, 1, 63, 64, 65, 200}) {
+        const auto v = every_third_null(n);
+        size_t engaged = 0;
+        long sum = 0;
+        std::vector<int> stripped;
+        for (size_t i = 0; i < n; i++) {
+            engaged += i % 3 != 0;
+            sum += i % 3 != 0 ? long(i) : 0;
+            stripped.push_back(i % 3 != 0 ? int(i) : -1);
+        }
+        TEST(v.count_engaged() == engaged);
+        TEST(f::foldl([](long acc, int x) { return acc + x; }, 0L, v) == sum);
+        TEST(vec_eq(f::strip(v, -1), stripped));
+
+        const auto squares = f::fmap([](int x) { return double(x) * x; }, v);
+        TEST(squares.size() == n && squares.count_engaged() == engaged);
+        bool same = true;
+        for (size_t i = 0; i < n; i++)
+            same = same && squares.has_value(i) == v.has_value(i)
+                        && (!v.has_value(i) || *squares[i] == double(i) * i);
+        TEST(same);
+    }
+
+    f::OptionalVector<int> full;
+    for (int i = 0; i < 128; i++)
+        full.push_back(i);
+    TEST(full.count_engaged() == 128);
+    TEST(f::foldl([](int acc, int x) { return acc + x; }, 0, full) == 127 * 128 / 2);
+    // fmap does not call f on disengaged lanes.
+    f::OptionalVector<int> divisors{f::Optional<int>(2), f::Optional<int>(), f::Optional<int>(4)};
+    const auto quotients = f::fmap([](int d) { return 8 / d; }, divisors);
+    TEST(*quotients[0] == 4 && !quotients[1] && *quotients[2] == 2);
+}
+
+void test_bulk_strip() {
+    std::vector<f::Optional<int>> ints{f::Optional<int>(1), f::Optional<int>(), f::Optional<int>(-3)};
+    TEST(vec_eq(f::strip(ints, 0), std::vector<int>({1, 0, -3})));
+    std::vector<std::optional<double>> doubles{2.5, std::nullopt, std::nullopt};
+    TEST(vec_eq(f::strip(doubles, -1.0), std::vector<double>({2.5, -1.0, -1.0})));
+    std::vector<f::CompactOptional<double>> compact{f::CompactOptional<double>(), 1.0};
+    TEST(vec_eq(f::strip(compact, 9.0), std::vector<double>({9.0, 1.0})));
+    std::vector<f::Optional<char>> chars{f::Optional<char>('a'), f::Optional<char>()};
+    TEST(vec_eq(f::strip(chars, 'z'), std::string("az")));
+
+    // Heavy values are moved out of an rvalue range, and copied otherwise.
+    std::vector<f::Optional<std::string>> strings;
+    strings.emplace_back(std::string(100, 'x'));
+    strings.emplace_back();
+    const auto copied = f::strip(strings, std::string("none"));
+    TEST(vec_eq(copied, std::vector<std::string>({std::string(100, 'x'), "none"})));
+    TEST(**strings.begin() == std::string(100, 'x'));
+    const auto moved = f::strip(std::move(strings), std::string("none"));
+    TEST(vec_eq(moved, copied));
+
+    std::vector<long> out(3, 7);
+    const std::vector<std::optional<long>> longs{std::nullopt, 4L};
+    const auto end = f::strip_iterator(longs.begin(), longs.end(), out.begin(), 0L);
+    TEST(end == out.begin() + 2);
+    TEST(vec_eq(out, std::vector<long>({0, 4, 7})));
+}
+
+void benchmark_null_fill() {
+    // Null filling a column of Optionals, blend against a branch per element.
+    constexpr size_t N = 1 << 20;
+    std::vector<f::Optional<double>> rows(N);
+    for (size_t i = 0; i < N; i++)
+        if ((i * 2654435761u) % 100 < 50)
+            rows[i] = double(i);
+    auto begin = std::chrono::steady_clock::now();
+    const auto blended = f::strip(rows, 0.0);
+    const double blend_ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - begin).count();
+    begin = std::chrono::steady_clock::now();
+    std::vector<double> branched(N);
+    for (size_t i = 0; i < N; i++)
+        branched[i] = rows[i] ? *rows[i] : 0.0;
+    const double branch_ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - begin).count();
+    std::cout << "null fill: blend " << blend_ns / N << " ns, branch "
+              << branch_ns / N << " ns per element" << std::endl;
+    TEST(vec_eq(blended, branched));
+}
+
+void benchmark_null_sum() {
+    // Sum over a column with 10% nulls, columnar against a vector of Optionals.
+    constexpr size_t N = 1 << 20;
+    f::OptionalVector<double> column;
+    std::vector<f::Optional<double>> rows;
+    for (size_t i = 0; i < N; i++) {
+        if (i % 10 == 0) {
+            column.push_back(f::nullvalue);
+            rows.emplace_back();
+        }
+        else {
+            column.push_back(1.0);
+            rows.emplace_back(1.0);
+        }
+    }
+    const auto plus = [](double a, double b) { return a + b; };
+    auto begin = std::chrono::steady_clock::now();
+    const double columnar = f::foldl(plus, 0.0, column);
+    const double columnar_ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - begin).count();
+    begin = std::chrono::steady_clock::now();
+    double row = 0.0;
+    for (auto const& o : rows)
+        if (o) row += *o;
+    const double row_ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - begin).count();
+    std::cout << "null-skipping sum: OptionalVector " << columnar_ns / N << " ns, "
+              << "vector<Optional> " << row_ns / N << " ns per element, "
+              << sizeof(double) * 8 + 1 << " vs " << sizeof(f::Optional<double>) * 8
+              << " bits per element" << std::endl;
+    TEST(columnar == row);
+}
+
+int main(int argc, char **argv) {
+    ltcontext_begin(argc, argv);
+
+	TEST_UNIT(test_push_access());
+	TEST_UNIT(test_push_throws());
+	TEST_UNIT(test_bulk_ops());
+	TEST_UNIT(test_bulk_strip());
+	TEST_UNIT(benchmark_null_sum());
+	TEST_UNIT(benchmark_null_fill());
+
+    return ltcontext_end();
+}
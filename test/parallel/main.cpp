@@ -0,0 +1,340 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <numeric>
+#include <thread>
+#include <chrono>
+#include <mutex>
+
+#include "../libtester-2.0.h"
+
+#include "../../TinyFunctionalParallel.hpp"
+
+bool vec_eq(auto a, auto b) {
+    if (a.size() != b.size())
+        return false;
+    return std::equal(a.begin(), a.end(), b.begin());
+};
+
+void test_spsc_ring() {
+    f::SpscRing<int> ring(5);
+    TEST(ring.capacity() == 8);
+
+    int in[10] = {0,1,2,3,4,5,6,7,8,9};
+    TEST(ring.push_batch(in, 10) == 8);
+    TEST(ring.size() == 8);
+    TEST(ring.push_batch(in + 8, 2) == 0);
+
+    int out[10] = {};
+    TEST(ring.pop_batch(out, 3) == 3);
+    TEST(out[0] == 0 && out[2] == 2);
+    TEST(ring.push_batch(in + 8, 2) == 2);
+    TEST(ring.pop_batch(out, 10) == 7);
+    TEST(out[0] == 3 && out[6] == 9);
+    TEST(ring.pop_batch(out, 10) == 0);
+}
+
+void test_spsc_ring_threads() {
+    constexpr int N = 100000;
+    f::SpscRing<int> ring(64);
+    std::thread producer([&] {
+        for (int i = 0; i < N; ) {
+            int batch[16];
+            const int n = std::min(16, N - i);
+            for (int k = 0; k < n; k++)
+                batch[k] = i + k;
+            int sent = 0;
+            while (sent < n)
+                sent += ring.push_batch(batch + sent, n - sent);
+            i += n;
+        }
+    });
+    long sum = 0;
+    int expected = 0;
+    bool ordered = true;
+    while (expected < N) {
+        int out[32];
+        const size_t n = ring.pop_batch(out, 32);
+        for (size_t k = 0; k < n; k++) {
+            ordered = ordered && out[k] == expected++;
+            sum += out[k];
+        }
+    }
+    producer.join();
+    TEST(ordered);
+    TEST(sum == long(N) * (N - 1) / 2);
+}
+
+struct Point3 { float x, y, z; };
+
+static_assert(sizeof(f::AtomicOptional<int>) == sizeof(uint64_t));
+static_assert(sizeof(f::AtomicOptional<char>) == sizeof(uint16_t));
+static_assert(sizeof(f::AtomicOptional<Point3>) == 16);
+static_assert(f::AtomicOptional<int>::is_always_lock_free);
+static_assert(f::AtomicOptional<Point3>::is_always_lock_free);
+
+void test_atomic_optional() {
+    f::AtomicOptional<int> slot;
+    TEST(!slot.load() && !slot.try_take());
+    TEST(slot.try_put(0));
+    TEST(!slot.try_put(1));
+    TEST(*slot.load() == 0);
+    TEST(*slot.try_take() == 0);
+    TEST(!slot.try_take());
+
+    TEST(!slot.exchange(f::Optional<int>(7)));
+    TEST(*slot.exchange(f::Optional<int>(-1)) == 7);
+    TEST(*slot.exchange(f::nullvalue) == -1);
+    TEST(!slot.load());
+
+    f::AtomicOptional<Point3> point(Point3{1.0f, 2.0f, 3.0f});
+    TEST(!point.try_put(Point3{}));
+    const auto p = point.try_take();
+    TEST(p && p->x == 1.0f && p->y == 2.0f && p->z == 3.0f);
+    TEST(point.try_put(Point3{}) && point.try_take()->z == 0.0f);
+
+    f::AtomicOptional<double> d;
+    TEST(d.try_put(0.5) && *d.exchange(f::Optional<double>(1.5)) == 0.5 && *d.load() == 1.5);
+}
+
+template <class Mailbox>
+long mailbox_handoff(Mailbox& mailbox, int n, int consumers) {
+    // One producer hands n values to the consumers through a single slot.
+    std::atomic<long> sum{0};
+    std::atomic<int> taken{0};
+    std::vector<std::thread> threads;
+    for (int c = 0; c < consumers; c++)
+        threads.emplace_back([&] {
+            long local = 0;
+            while (taken.load(std::memory_order_relaxed) < n) {
+                if (const auto v = mailbox.try_take()) {
+                    local += *v;
+                    taken.fetch_add(1, std::memory_order_relaxed);
+                }
+                else
+                    std::this_thread::yield();
+            }
+            sum += local;
+        });
+    for (int i = 0; i < n; i++)
+        while (!mailbox.try_put(i))
+            std::this_thread::yield();
+    for (auto& t : threads)
+        t.join();
+    return sum;
+}
+
+void test_atomic_optional_threads() {
+    constexpr int N = 20000;
+    f::AtomicOptional<int> slot;
+    TEST(mailbox_handoff(slot, N, 3) == long(N) * (N - 1) / 2);
+    TEST(!slot.load());
+
+    f::AtomicOptional<Point3> points;
+    std::thread producer([&] {
+        for (int i = 1; i <= N; i++)
+            while (!points.try_put(Point3{float(i), float(-i), float(2 * i)}))
+                std::this_thread::yield();
+    });
+    bool torn = false;
+    for (int i = 1; i <= N; ) {
+        if (const auto p = points.try_take()) {
+            torn = torn || p->x != float(i) || p->y != -p->x || p->z != 2 * p->x;
+            i++;
+        }
+        else
+            std::this_thread::yield();
+    }
+    producer.join();
+    TEST(!torn);
+}
+
+struct MutexMailbox {
+    bool try_put(int v) {
+        std::lock_guard lock(mutex);
+        if (slot)
+            return false;
+        slot = v;
+        return true;
+    }
+    f::Optional<int> try_take(void) {
+        std::lock_guard lock(mutex);
+        const auto v = slot;
+        slot = f::nullvalue;
+        return v;
+    }
+    std::mutex mutex;
+    f::Optional<int> slot;
+};
+
+void benchmark_mailbox() {
+    constexpr int N = 20000;
+    f::AtomicOptional<int> atomic_box;
+    MutexMailbox mutex_box;
+    auto begin = std::chrono::steady_clock::now();
+    const long atomic_sum = mailbox_handoff(atomic_box, N, 3);
+    const double atomic_ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - begin).count();
+    begin = std::chrono::steady_clock::now();
+    const long mutex_sum = mailbox_handoff(mutex_box, N, 3);
+    const double mutex_ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - begin).count();
+    std::cout << "mailbox handoff: AtomicOptional " << atomic_ns / N << " ns, mutex "
+              << mutex_ns / N << " ns per value" << std::endl;
+    TEST(atomic_sum == mutex_sum);
+}
+
+void test_async_pipeline() {
+    std::vector<int> ints(100000);
+    std::iota(ints.begin(), ints.end(), 0);
+
+    const auto caller = std::this_thread::get_id();
+    std::thread::id parse_thread, sink_thread;
+    std::vector<long> out;
+    ints >> fp::transform([&](int v) { parse_thread = std::this_thread::get_id(); return long(v) * 2; })
+         >> fp::async<long>(256, 16)
+         >> fp::filter([](long v) { return v % 3 == 0; })
+         >> fp::sink([&](long v) { sink_thread = std::this_thread::get_id(); out.push_back(v); });
+
+    TEST(parse_thread == caller);
+    TEST(sink_thread != caller);
+    long expected = 0;
+    size_t count = 0;
+    for (int v : ints)
+        if ((long(v) * 2) % 3 == 0) {
+            expected += long(v) * 2;
+            count++;
+        }
+    TEST(out.size() == count);
+    TEST(std::accumulate(out.begin(), out.end(), 0L) == expected);
+    TEST(std::is_sorted(out.begin(), out.end()));
+}
+
+void test_async_chain_reuse() {
+    std::vector<std::string> out;
+    auto pipeline = fp::transform([](int v) { return std::to_string(v); })
+                  >> fp::async<std::string>(8, 3)
+                  >> fp::transform([](std::string s) { return s + "!"; })
+                  >> fp::async<std::string>(8, 2)
+                  >> fp::push_back(out);
+
+    const std::vector<int> a{1,2,3,4,5};
+    const std::vector<int> b{6,7};
+    a >> pipeline;
+    TEST(vec_eq(out, std::vector<std::string>({"1!", "2!", "3!", "4!", "5!"})));
+    b >> pipeline;
+    TEST(out.size() == 7);
+    TEST(out.back() == "7!");
+}
+
+void test_async_backpressure() {
+    std::vector<int> ints(20000);
+    std::iota(ints.begin(), ints.end(), 0);
+
+    auto stage = fp::async<int>(fp::AsyncConfig{64, 1, 32});
+    const auto gauge = stage.gauge();
+    TEST(gauge->batch == 1);
+
+    long sum = 0;
+    ints >> std::move(stage) >> fp::sink([&](int v) {
+        // A slow sink forces the producer to wait for credits.
+        if (v % 1000 == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        sum += v;
+    });
+    TEST(sum == long(ints.size()) * long(ints.size() - 1) / 2);
+    TEST(gauge->max_depth <= 64);
+    TEST(gauge->stalls > 0);
+    TEST(gauge->batch > 1);
+    TEST(gauge->depth == 0);
+    std::cout << "max depth " << gauge->max_depth << ", stalls " << gauge->stalls
+              << ", batch " << gauge->batch << std::endl;
+}
+
+void test_async_shared_gauge() {
+    // A stage composed as an lvalue is copied, and the copy reports to the
+    // gauge taken from the original.
+    std::vector<int> ints(2000);
+    std::iota(ints.begin(), ints.end(), 0);
+    auto stage = fp::async<int>(fp::AsyncConfig{16, 1, 8});
+    const auto gauge = stage.gauge();
+    long sum = 0;
+    ints >> stage >> fp::sink([&](int v) {
+        if (v % 100 == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        sum += v;
+    });
+    TEST(sum == 1999L * 2000 / 2);
+    TEST(gauge->max_depth > 0);
+    TEST(gauge->stalls > 0);
+}
+
+void test_async_idle_batch() {
+    // A slow producer finds the consumer idle, batches shrink to the minimum.
+    std::vector<int> ints(200);
+    std::iota(ints.begin(), ints.end(), 0);
+    auto stage = fp::async<int>(fp::AsyncConfig{64, 2, 32});
+    const auto gauge = stage.gauge();
+    long sum = 0;
+    ints >> fp::transform([](int v) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            return v;
+        })
+         >> std::move(stage)
+         >> fp::sink([&](int v) { sum += v; });
+    TEST(sum == 199L * 200 / 2);
+    TEST(gauge->batch == 2);
+    TEST(gauge->stalls == 0);
+}
+
+void test_async_trickle() {
+    // Batches grown under a slow sink shrink again once the producer slows
+    // down: trickled elements are handed over as they come, not at the end.
+    constexpr int burst = 5000, trickle = 8;
+    std::vector<int> ints(burst + trickle);
+    std::iota(ints.begin(), ints.end(), 0);
+    auto stage = fp::async<int>(fp::AsyncConfig{64, 1, 32});
+    const auto gauge = stage.gauge();
+    std::atomic<int> delivered{0};
+    size_t grown = 0;
+    std::vector<int> seen;
+    ints >> fp::transform([&](int v) {
+            if (v == burst)
+                grown = gauge->batch;
+            if (v >= burst) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                seen.push_back(delivered.load() - v);
+            }
+            return v;
+        })
+         >> std::move(stage)
+         >> fp::sink([&](int v) {
+            if (v < burst && v % 100 == 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            delivered++;
+        });
+    TEST(delivered == burst + trickle);
+    TEST(grown > 1);
+    // After the pause before a trickled element, the trickled elements before
+    // it were delivered. The tail of the burst is handed over with the first.
+    TEST(std::all_of(seen.begin() + 1, seen.end(), [](int d) { return d == 0; }));
+}
+
+int main(int argc, char **argv) {
+    ltcontext_begin(argc, argv);
+
+	TEST_UNIT(test_spsc_ring());
+	TEST_UNIT(test_spsc_ring_threads());
+	TEST_UNIT(test_atomic_optional());
+	TEST_UNIT(test_atomic_optional_threads());
+	TEST_UNIT(benchmark_mailbox());
+	TEST_UNIT(test_async_pipeline());
+	TEST_UNIT(test_async_chain_reuse());
+	TEST_UNIT(test_async_backpressure());
+	TEST_UNIT(test_async_shared_gauge());
+	TEST_UNIT(test_async_idle_batch());
+	TEST_UNIT(test_async_trickle());
+
+    return ltcontext_end();
+}
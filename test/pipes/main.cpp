@@ -0,0 +1,129 @@
+#include <iostream>
+#include <vector>
+#include <list>
+#include <string>
+#include <sstream>
+
+#include "../libtester-2.0.h"
+
+#include "../../TinyFunctional.hpp"
+
+bool vec_eq(auto a, auto b) {
+    if (a.size() != b.size())
+        return false;
+    return std::equal(a.begin(), a.end(), b.begin());
+};
+
+auto vec_str(const std::string name, auto vec) {
+    std::stringstream ss{""};
+    if (vec.empty()) {
+        ss << name << ": <empty>";
+        return ss.str();
+    }
+    ss << name << ": {"; 
+    for (auto v: vec)
+        ss << v << " "; 
+    ss << "}"; 
+    return ss.str();
+};
+
+auto vec_print(const std::string name, auto vec) {
+    std::cout << vec_str(name, vec) << std::endl;
+};
+
+const auto is_odd = [](int v) { return v % 2 != 0; };
+const auto square = [](int v) { return v*v; };
+
+void test_source_to_sink() {
+    const std::vector<int> ints{1,2,3,4,5};
+    std::vector<int> out;
+    fp::source(ints) >> fp::push_back(out);
+    TEST(vec_eq(out, ints));
+
+    int sum = 0;
+    ints >> fp::sink([&](int v) { sum += v; });
+    TEST(sum == 15);
+}
+
+void test_pipeline() {
+    const std::vector<int> ints{1,2,3,4,5};
+    std::vector<std::string> out;
+    ints >> fp::filter(is_odd)
+         >> fp::transform(square)
+         >> fp::transform([](int v) { return std::to_string(v); })
+         >> fp::push_back(out);
+    vec_print("odd squares", out);
+    TEST(vec_eq(out, std::vector<std::string>({"1", "9", "25"})));
+}
+
+void test_reusable_pipeline() {
+    std::vector<int> out;
+    auto odd_squares = fp::filter(is_odd) >> fp::transform(square) >> fp::push_back(out);
+
+    std::vector<int> a{1,2,3};
+    std::list<int> b{4,5};
+    a >> odd_squares;
+    b >> odd_squares;
+    TEST(vec_eq(out, std::vector<int>({1, 9, 25})));
+}
+
+void test_lazy_source() {
+    const std::vector<int> ints{1,2,3,4,5,6,7,8};
+    std::vector<int> out;
+    f::take(3, f::filter(is_odd, ints)) >> fp::transform(square) >> fp::push_back(out);
+    TEST(vec_eq(out, std::vector<int>({1, 9, 25})));
+}
+
+void test_stateful_stages() {
+    const std::vector<int> ints{5,6,7};
+    std::vector<int> out;
+    ints >> fp::transform([n = 0](int v) mutable { return v * 10 + n++; })
+         >> fp::push_back(out);
+    TEST(vec_eq(out, std::vector<int>({50, 61, 72})));
+
+    static_assert(sizeof(fp::filter(is_odd) >> fp::transform(square)) == 1);
+}
+
+void test_multi_sink() {
+    const std::vector<int> ints{1,2,3,4,5,6};
+
+    int sum = 0;
+    int count = 0;
+    std::vector<int> squares;
+    ints >> fp::tee(fp::sink([&](int v) { sum += v; }),
+                    fp::sink([&](int) { count++; }),
+                    fp::transform(square) >> fp::push_back(squares));
+    TEST(sum == 21);
+    TEST(count == 6);
+    TEST(vec_eq(squares, std::vector<int>({1, 4, 9, 16, 25, 36})));
+
+    std::vector<int> odds, evens;
+    ints >> fp::partition(is_odd, fp::push_back(odds), fp::push_back(evens));
+    TEST(vec_eq(odds, std::vector<int>({1, 3, 5})));
+    TEST(vec_eq(evens, std::vector<int>({2, 4, 6})));
+
+    std::vector<std::string> mod3[3];
+    std::vector<int> dropped;
+    ints >> fp::transform([](int v) { return std::to_string(v); })
+         >> fp::demux([](const std::string& v) { return std::stoi(v) % 3; },
+                      fp::push_back(mod3[0]), fp::push_back(mod3[1]), fp::push_back(mod3[2]));
+    TEST(vec_eq(mod3[0], std::vector<std::string>({"3", "6"})));
+    TEST(vec_eq(mod3[1], std::vector<std::string>({"1", "4"})));
+    TEST(vec_eq(mod3[2], std::vector<std::string>({"2", "5"})));
+
+    ints >> fp::demux([](int v) { return v > 4 ? 7 : 0; }, fp::push_back(dropped));
+    TEST(vec_eq(dropped, std::vector<int>({1, 2, 3, 4})));
+}
+
+int main(int argc, char **argv) {
+    ltcontext_begin(argc, argv);
+
+	TEST_UNIT(test_source_to_sink());
+	TEST_UNIT(test_pipeline());
+	TEST_UNIT(test_reusable_pipeline());
+	TEST_UNIT(test_lazy_source());
+	TEST_UNIT(test_stateful_stages());
+	TEST_UNIT(test_multi_sink());
+
+    return ltcontext_end();
+}